@@ -0,0 +1,163 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// Renders the same scene with polar shadow maps and with shadow geometry, and compares the results.
+// Needs no interaction, so it can run without a display server of its own, for example on Mesa's software rasterizer:
+//     LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./shadowMapCheck
+// Run it from the bin directory. Returns 0 if the images match within the tolerance, and writes both images otherwise
+
+#include <LTBL/Light/LightSystem.h>
+#include <LTBL/Light/Light_Point.h>
+#include <LTBL/Utils.h>
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+	const unsigned int checkSize = 512;
+
+	// Penumbras are blurred differently by the two paths, so small differences are allowed on a few pixels
+	const int maxChannelDifference = 24;
+	const float maxDifferingFraction = 0.01f;
+
+	ltbl::ConvexHull* CreateBox(const Vec2f &center, const Vec2f &halfDims)
+	{
+		ltbl::ConvexHull* pHull = new ltbl::ConvexHull();
+
+		pHull->m_vertices.push_back(Vec2f(-halfDims.x, -halfDims.y));
+		pHull->m_vertices.push_back(Vec2f(halfDims.x, -halfDims.y));
+		pHull->m_vertices.push_back(Vec2f(halfDims.x, halfDims.y));
+		pHull->m_vertices.push_back(Vec2f(-halfDims.x, halfDims.y));
+
+		pHull->CalculateNormals();
+		pHull->CalculateAABB();
+
+		pHull->SetWorldCenter(center);
+
+		// The shadow map treats the hull itself as occluded, like opaque hulls without light over them
+		pHull->m_renderLightOverHull = false;
+
+		return pHull;
+	}
+
+	ltbl::Light_Point* CreateLight(const Vec2f &center, float radius, const Color3f &color, float spreadAngle = ltbl::pifTimes2, float directionAngle = 0.0f)
+	{
+		ltbl::Light_Point* pLight = new ltbl::Light_Point();
+
+		pLight->m_center = center;
+		pLight->m_radius = radius;
+		pLight->m_size = 2.0f;
+		pLight->m_color = color;
+		pLight->m_spreadAngle = spreadAngle;
+		pLight->m_directionAngle = directionAngle;
+
+		// Lights with a soft portion always use shadow geometry
+		pLight->m_softSpreadAngle = 0.0f;
+
+		pLight->CalculateAABB();
+
+		return pLight;
+	}
+
+	sf::Image Render(ltbl::LightSystem &ls, sf::RenderWindow &win, const sf::View &view, bool useShadowMaps)
+	{
+		ls.m_useShadowMaps = useShadowMaps;
+
+		// The first frame sets up the state of the path, the second is compared
+		for(int i = 0; i < 2; i++)
+		{
+			// The light texture is multiplied with the window, so a white window shows it unchanged
+			win.clear(sf::Color::White);
+
+			win.setView(view);
+			ls.SetView(view);
+
+			ls.RenderLights();
+			ls.RenderLightTexture();
+		}
+
+		return win.capture();
+	}
+}
+
+int main(int argc, char* args[])
+{
+	sf::RenderWindow win(sf::VideoMode(checkSize, checkSize), "Let there be Light - Shadow map check", sf::Style::None);
+	win.setVisible(false);
+
+	sf::View view(sf::FloatRect(0.0f, 0.0f, static_cast<float>(checkSize), static_cast<float>(checkSize)));
+
+	ltbl::LightSystem ls(AABB(Vec2f(0.0f, 0.0f), Vec2f(static_cast<float>(checkSize), static_cast<float>(checkSize))), &win, "data/lightFin.png", "data/shaders/lightAttenuationShader.frag");
+
+	ls.m_ambientColor = sf::Color::Black;
+	ls.m_useBloom = false;
+
+	ls.AddConvexHull(CreateBox(Vec2f(180.0f, 200.0f), Vec2f(30.0f, 15.0f)));
+	ls.AddConvexHull(CreateBox(Vec2f(330.0f, 300.0f), Vec2f(20.0f, 40.0f)));
+	ls.AddConvexHull(CreateBox(Vec2f(250.0f, 400.0f), Vec2f(60.0f, 10.0f)));
+
+	ls.AddLight(CreateLight(Vec2f(250.0f, 250.0f), 300.0f, Color3f(1.0f, 1.0f, 1.0f)));
+	ls.AddLight(CreateLight(Vec2f(100.0f, 380.0f), 200.0f, Color3f(1.0f, 0.4f, 0.2f)));
+	ls.AddLight(CreateLight(Vec2f(420.0f, 150.0f), 250.0f, Color3f(0.2f, 0.5f, 1.0f), ltbl::pif / 2.0f, ltbl::pif));
+
+	const sf::Image geometry(Render(ls, win, view, false));
+	const sf::Image shadowMap(Render(ls, win, view, true));
+
+	unsigned int numDiffering = 0;
+	int maxDifference = 0;
+
+	for(unsigned int y = 0; y < checkSize; y++)
+		for(unsigned int x = 0; x < checkSize; x++)
+		{
+			sf::Color a(geometry.getPixel(x, y));
+			sf::Color b(shadowMap.getPixel(x, y));
+
+			int difference = std::max(std::abs(a.r - b.r), std::max(std::abs(a.g - b.g), std::abs(a.b - b.b)));
+
+			maxDifference = std::max(maxDifference, difference);
+
+			if(difference > maxChannelDifference)
+				numDiffering++;
+		}
+
+	const float differingFraction = static_cast<float>(numDiffering) / (checkSize * checkSize);
+
+	std::cout << "Pixels differing by more than " << maxChannelDifference << ": " << differingFraction * 100.0f << "%, largest difference " << maxDifference << std::endl;
+
+	if(differingFraction > maxDifferingFraction)
+	{
+		geometry.saveToFile("shadowMapCheckGeometry.png");
+		shadowMap.saveToFile("shadowMapCheckShadowMap.png");
+
+		std::cout << "Failed, wrote shadowMapCheckGeometry.png and shadowMapCheckShadowMap.png" << std::endl;
+
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Passed" << std::endl;
+
+	return EXIT_SUCCESS;
+}
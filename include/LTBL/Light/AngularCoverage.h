@@ -0,0 +1,62 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_ANGULARCOVERAGE_H
+#define LTBL_ANGULARCOVERAGE_H
+
+#include <vector>
+
+namespace ltbl
+{
+	// Set of angular intervals around a light, each occluded beyond a certain distance.
+	// Angles are in radians and may lie outside of [-pi, pi), they are wrapped internally.
+	class AngularCoverage
+	{
+	private:
+		struct Interval
+		{
+			float m_lower;
+			float m_upper;
+			float m_distance;
+
+			bool operator<(const Interval &other) const;
+		};
+
+		std::vector<Interval> m_intervals;
+
+		// Scratch space for coverage queries
+		mutable std::vector<Interval> m_query;
+
+		bool CoveredWrapped(float lower, float upper, float distance) const;
+
+	public:
+		void Clear();
+
+		// Everything between the angles farther away than distance is occluded
+		void Add(float lowerAngle, float upperAngle, float distance);
+
+		// Returns true if the angular range is occluded at the given distance
+		bool Covered(float lowerAngle, float upperAngle, float distance) const;
+	};
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_BLOOMPIPELINE_H
+#define LTBL_BLOOMPIPELINE_H
+
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <SFML/Graphics/Shader.hpp>
+
+#include <LTBL/Light/TextureFormat.h>
+#include <LTBL/Constructs.h>
+
+namespace ltbl
+{
+	// Glow around bright parts of the lighting. The bright parts are taken from the composition with a threshold
+	// into a half resolution texture, halved further into a chain of levels, each level is blurred with a separable
+	// Gaussian, and the levels are added back up into the first one. The cost does not depend on the number of lights.
+	class BloomPipeline
+	{
+	public:
+		enum Quality
+		{
+			quality_low, quality_medium, quality_high
+		};
+
+		static const int s_maxLevels = 6;
+
+	private:
+		// Each level has a second texture for the first half of the blur
+		sf::RenderTexture m_levels[s_maxLevels];
+		sf::RenderTexture m_blurLevels[s_maxLevels];
+
+		int m_numLevels;
+
+		sf::Shader m_brightPassShader;
+		sf::Shader m_blurShader;
+		sf::Shader m_copyShader;
+
+		bool m_shadersLoaded;
+		bool m_available;
+
+		void BeginPass(sf::RenderTexture &target);
+
+	public:
+		BloomPipeline();
+
+		// Requires a valid context. Compiles the shaders, the levels are created by Resize
+		void Create();
+
+		// Requires a valid context. Recreates the levels for a composition of the size, discarding their format
+		void Resize(unsigned int width, unsigned int height);
+
+		// Storage of all levels, should be one of the color formats. Discards the contents
+		void SetFormat(TextureFormat format);
+
+		// False if shaders are not supported
+		bool Available() const;
+
+		// Extracts everything above the threshold from the composition, adds the extra bloom texture (not thresholded) and blurs it
+		void Render(const sf::Texture &composition, const sf::Texture &extraBloom, float threshold, Quality quality);
+
+		// Result of the last render, at half resolution
+		const sf::Texture &GetTexture() const;
+	};
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_CLIPREGION_H
+#define LTBL_CLIPREGION_H
+
+#include <LTBL/Constructs.h>
+
+#include <vector>
+
+namespace ltbl
+{
+	// Convex polygon (counter-clockwise) that shadow geometry is clipped against before it is rendered
+	class ClipRegion
+	{
+	private:
+		std::vector<Vec2f> m_vertices;
+
+		// Scratch buffers for clipping
+		mutable std::vector<Vec2f> m_tempPositions;
+		mutable std::vector<Vec2f> m_tempTexCoords;
+
+	public:
+		// Polygon enclosing the circle
+		void SetCircle(const Vec2f &center, float radius, int numSides);
+		void SetAABB(const AABB &aabb);
+
+		// Shrinks the region to its intersection with the AABB
+		void Intersect(const AABB &aabb);
+
+		bool Empty() const;
+
+		const std::vector<Vec2f> &GetVertices() const;
+
+		// Clips a convex polygon in place. Texture coordinates are interpolated along, if there are any
+		void ClipPolygon(std::vector<Vec2f> &positions, std::vector<Vec2f> &texCoords) const;
+
+		// Keeps the part of the polygon on the left side of the directed line from start to end
+		static void ClipToLine(const Vec2f &start, const Vec2f &end, std::vector<Vec2f> &positions, std::vector<Vec2f> &texCoords,
+			std::vector<Vec2f> &resultPositions, std::vector<Vec2f> &resultTexCoords);
+	};
+}
+
+#endif
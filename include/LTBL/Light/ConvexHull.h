@@ -37,7 +37,12 @@ namespace ltbl
 
 		Vec2f m_worldCenter;
 
-		bool m_updateRequired;
+		// Counts changes to the hull
+		unsigned int m_generation;
+
+		// Generation and bounds the light system last invalidated the cached static lights for
+		unsigned int m_lightGeneration;
+		AABB m_lightAABB;
 
 		bool m_render;
 
@@ -66,6 +71,13 @@ namespace ltbl
 		void SetWorldCenter(const Vec2f &newCenter);
 		void IncWorldCenter(const Vec2f &increment);
 
+		// Moving the hull and calculating its AABB invalidate it on their own. Call this after changing the transparency,
+		// m_renderLightOverHull or the vertices in place, so the cached lighting around it is rebuilt
+		void Invalidate();
+
+		// Changes whenever the hull is invalidated
+		unsigned int GetGeneration() const;
+
 		Vec2f GetWorldCenter() const;
 
 		bool PointInsideHull(const Vec2f &point);
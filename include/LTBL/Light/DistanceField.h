@@ -0,0 +1,152 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_DISTANCEFIELD_H
+#define LTBL_DISTANCEFIELD_H
+
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <SFML/Graphics/Shader.hpp>
+
+#include <LTBL/QuadTree/QuadTreeOccupant.h>
+#include <LTBL/Light/ConvexHull.h>
+#include <LTBL/Light/LightQuads.h>
+#include <LTBL/Light/RenderTargetUtils.h>
+#include <LTBL/Constructs.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace ltbl
+{
+	// Shadow backend whose cost does not depend on the number of hulls. The hulls in view are drawn into an
+	// occupancy texture, a jump flood turns it into the nearest hull pixel for every pixel, and lights are shaded
+	// by marching from each pixel towards the light, taking the nearest distance along the way as the penumbra.
+	class DistanceField
+	{
+	private:
+		// What the occupancy of a hull was drawn from
+		struct HullState
+		{
+			AABB m_aabb;
+			unsigned int m_generation;
+			bool m_renderLightOverHull;
+			unsigned int m_frame;
+		};
+
+		// World tile held by a tile of the occupancy texture
+		struct Tile
+		{
+			int m_x, m_y;
+			bool m_dirty;
+		};
+
+		LightQuads m_quads[num_lightTargets];
+
+		// Size of the render target the lights are drawn to, in pixels
+		Vec2f m_viewSize;
+		float m_scale;
+
+		// Render target pixels per world unit of the last view
+		float m_pixelsPerUnit;
+
+		// Tiles are aligned to multiples of their world size, so they keep their contents while the view moves
+		float m_tileWorldSize;
+
+		unsigned int m_fieldWidth;
+		unsigned int m_fieldHeight;
+
+		// Hull mask, red for all hulls, green for hulls that are lit on top. A world tile is stored at its
+		// index modulo the number of tiles, so tiles that stay in the field do not move in the texture
+		sf::RenderTexture m_occupancyTexture;
+
+		// Nearest hull pixel, ping-ponged during the jump flood. Unlike the occupancy, the field starts at the origin tile
+		sf::RenderTexture m_seedTextures[2];
+		unsigned int m_seedIndex;
+
+		sf::Shader m_seedShader;
+		sf::Shader m_floodShader;
+		sf::Shader m_lightShader;
+
+		bool m_shadersLoaded;
+		bool m_available;
+
+		unsigned int m_tileSize;
+		unsigned int m_numTilesX;
+		unsigned int m_numTilesY;
+
+		// World tile of the lower corner of the field
+		int m_originTileX;
+		int m_originTileY;
+
+		std::vector<Tile> m_tiles;
+		bool m_anyTileDirty;
+
+		// World region the field covers
+		AABB m_region;
+
+		std::unordered_map<ConvexHull*, HullState> m_hullStates;
+		unsigned int m_frame;
+
+		// Recreates the textures with room for the tiles, all tiles have to be redrawn
+		bool Resize(unsigned int numTilesX, unsigned int numTilesY);
+
+		// Marks the tiles overlapping the world region
+		void InvalidateRegion(const AABB &region);
+
+		void Flood();
+
+	public:
+		DistanceField();
+
+		// Requires a valid context. Scale is the resolution of the field relative to the render target
+		void Create(bool useVertexBuffer, float scale = 0.5f);
+
+		// Size of the render target in pixels. The textures are recreated for the next view
+		void SetViewSize(const Vec2f &viewSize);
+
+		// False if shaders are not supported, or before the view size is set
+		bool Available() const;
+
+		// Moves the field over the view, extended by the padding on all sides. Tiles that come into the field are redrawn on the next update.
+		// The textures grow to fit the padding, up to the maximum texture size
+		void SetView(const AABB &viewAABB, float padding);
+
+		// World region of the field, the hulls in it have to be passed to Update
+		const AABB &GetRegion() const;
+
+		// Redraws the occupancy of the tiles that came into the field or where hulls changed, and floods the field again if anything was redrawn
+		void Update(const std::vector<qdt::QuadTreeOccupant*> &hullsInRegion);
+
+		void Clear();
+		bool Empty(LightTarget target) const;
+
+		// Lights with a bloom color other than black are drawn into the bloom texture as well.
+		// The offset moves the center to the lower corner of the render target, the scale converts to its pixels
+		void AddLight(const Vec2f &center, float radius, float size, const Color3f &color, const Color3f &bloomColor, float bleed, float linearizeFactor,
+			float lowerAngle, float upperAngle, const Vec2f &pixelOffset, float pixelScale = 1.0f);
+
+		// Draws the lights of the target with the current blend function and transform, and clears them
+		void Render(LightTarget target);
+	};
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_EMISSIVEBATCH_H
+#define LTBL_EMISSIVEBATCH_H
+
+#include <SFML/Graphics/RenderTexture.hpp>
+
+#include <LTBL/Light/EmissiveLight.h>
+#include <LTBL/Light/RenderTargetUtils.h>
+#include <LTBL/Light/StreamBuffer.h>
+#include <LTBL/Constructs.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace ltbl
+{
+	// Collects the visible emissive lights and draws them with one streamed quad buffer per render target.
+	// Their textures are copied into an atlas the first time they are seen, textures that do not fit are drawn grouped by texture
+	class EmissiveBatch
+	{
+	private:
+		struct Vertex
+		{
+			float m_x, m_y;
+			float m_u, m_v;
+			float m_r, m_g, m_b, m_a;
+		};
+
+		struct AtlasRegion
+		{
+			bool m_inAtlas;
+
+			// Texture coordinates in the atlas
+			float m_lowerU, m_lowerV, m_upperU, m_upperV;
+		};
+
+		struct Quad
+		{
+			const sf::Texture* m_pTexture;
+
+			Vertex m_vertices[4];
+
+			bool operator<(const Quad &other) const
+			{
+				return m_pTexture < other.m_pTexture;
+			}
+		};
+
+		std::vector<EmissiveLight*> m_emissiveLights[num_lightTargets];
+
+		sf::RenderTexture m_atlas;
+		bool m_atlasCreated;
+
+		std::unordered_map<const sf::Texture*, AtlasRegion> m_atlasRegions;
+
+		// Shelf packing state
+		unsigned int m_shelfX, m_shelfY, m_shelfHeight;
+
+		std::vector<Vertex> m_vertices;
+		std::vector<Quad> m_looseQuads;
+
+		StreamBuffer m_stream;
+
+		bool AddToAtlas(const sf::Texture* pTexture, AtlasRegion &region);
+
+	public:
+		EmissiveBatch();
+
+		// Requires a valid context
+		void Create(bool useVertexBuffer);
+
+		void Clear();
+		bool Empty(LightTarget target) const;
+
+		void AddEmissive(EmissiveLight* pEmissive, LightTarget target);
+
+		// Copies textures that were not seen before into the atlas. Changes the active render target
+		void PackTextures();
+
+		// Forgets the atlas contents, for when the contents of emissive textures changed
+		void ClearAtlas();
+
+		// Draws all emissives of the target with the current blend function and transform
+		void Render(LightTarget target);
+	};
+}
+
+#endif
@@ -59,6 +59,8 @@ namespace ltbl
 		Vec2f GetCenter();
 		Vec2f GetDims();
 		float GetAngle();
+
+		friend class EmissiveBatch;
 	};
 }
 
@@ -0,0 +1,71 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_GPUTIMER_H
+#define LTBL_GPUTIMER_H
+
+namespace ltbl
+{
+	// Measures the GPU time between Begin and End with timestamp queries. Results are read a few frames later,
+	// so measuring never waits for the GPU. Queries are not shared between contexts, so Begin and End have to be
+	// called with the context active that was active at Create
+	class GPUTimer
+	{
+	private:
+		static const int s_numQueries = 4;
+
+		unsigned int m_startQueries[s_numQueries];
+		unsigned int m_endQueries[s_numQueries];
+
+		// Issued, but not read back yet
+		bool m_pending[s_numQueries];
+
+		int m_current;
+
+		// If all queries were still pending at Begin, so the current measurement is skipped
+		bool m_skipped;
+
+		bool m_available;
+
+		float m_time;
+
+		void CollectResults();
+
+	public:
+		GPUTimer();
+		~GPUTimer();
+
+		// Requires a valid context with GLEW initialized. Call again once the context of the queries was destroyed
+		void Create();
+
+		// False if timer queries are not supported
+		bool Available() const;
+
+		void Begin();
+		void End();
+
+		// Milliseconds of the latest finished measurement
+		float GetTime() const;
+	};
+}
+
+#endif
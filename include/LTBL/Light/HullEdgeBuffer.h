@@ -0,0 +1,116 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_HULLEDGEBUFFER_H
+#define LTBL_HULLEDGEBUFFER_H
+
+#include <SFML/Graphics/Shader.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include <LTBL/Light/ConvexHull.h>
+#include <LTBL/Constructs.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ltbl
+{
+	// Edges and vertices of all hulls, kept in vertex buffers that only change when hulls move.
+	// Umbras and fins are extruded from them in vertex shaders, where the silhouette is found per edge,
+	// so masking a light takes one draw for the umbras and one for the fins of all its hulls.
+	class HullEdgeBuffer
+	{
+	private:
+		struct Vertex
+		{
+			// Umbra quads: vertex, other vertex of the edge, neighbour of the vertex outside of the edge, hull center,
+			// then corner (0 near, 1 far), transparency, light over hull and if the vertex ends the edge.
+			// Fin triangles: vertex, previous vertex, next vertex, hull center,
+			// then corner (0 root, 1 penumbra, 2 umbra) and transparency
+			float m_attributes[12];
+		};
+
+		struct HullSlot
+		{
+			unsigned int m_umbraFirst;
+			unsigned int m_finFirst;
+			unsigned int m_numVertices;
+
+			Vec2f m_worldCenter;
+			float m_transparency;
+			bool m_renderLightOverHull;
+
+			// Vertex edits in place only show in the generation
+			unsigned int m_generation;
+		};
+
+		std::unordered_map<ConvexHull*, HullSlot> m_slots;
+
+		std::vector<Vertex> m_umbraVertices;
+		std::vector<Vertex> m_finVertices;
+
+		// 0 if not supported, then client side arrays are used
+		unsigned int m_umbraBuffer;
+		unsigned int m_finBuffer;
+
+		// Ranges of the hulls of the current light
+		std::vector<int> m_umbraFirsts;
+		std::vector<int> m_umbraCounts;
+		std::vector<int> m_finFirsts;
+		std::vector<int> m_finCounts;
+
+		sf::Shader m_umbraShader;
+		sf::Shader m_finShader;
+
+		bool m_available;
+		bool m_rebuildRequired;
+
+		void WriteHull(ConvexHull* pHull, HullSlot &slot);
+
+		void Rebuild(const std::unordered_set<ConvexHull*> &hulls);
+
+		void SetUpArrays(const std::vector<Vertex> &vertices, unsigned int buffer);
+		void ResetArrays(unsigned int buffer);
+
+	public:
+		HullEdgeBuffer();
+		~HullEdgeBuffer();
+
+		// Requires a valid context. Pass false to keep the edges in client side arrays
+		void Create(bool useVertexBuffer);
+
+		// False if shaders are not supported
+		bool Available() const;
+
+		// Rebuilds the buffers on the next update, when hulls were added or removed
+		void Invalidate();
+
+		// Rewrites the edges of hulls that moved or changed
+		void Update(const std::unordered_set<ConvexHull*> &hulls);
+
+		// Masks off the shadows of the hulls from the light, with the fin texture for the penumbras
+		void Render(const Vec2f &lightCenter, float lightRadius, float lightSize, const std::vector<ConvexHull*> &hulls, const sf::Texture &finTexture);
+	};
+}
+
+#endif
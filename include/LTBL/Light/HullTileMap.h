@@ -0,0 +1,104 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef LTBL_HULLTILEMAP_H
+#define LTBL_HULLTILEMAP_H
+
+#include <LTBL/Light/ConvexHull.h>
+#include <LTBL/Constructs.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace ltbl
+{
+	// Turns a tile occupancy grid into a small set of convex hulls.
+	// The grid is split into chunks, solid tiles of a chunk are merged into rectangles, which are then joined across the chunk seams.
+	// Tile changes only take apart the hulls reaching into the changed chunks, so the chunk size trades the cost of an update against
+	// how close the hulls are to the fewest possible ones.
+	// The generated hulls are owned by the light system, like any other hull.
+	class HullTileMap
+	{
+	private:
+		class LightSystem* m_pLightSystem;
+
+		int m_width;
+		int m_height;
+
+		int m_chunkSize;
+		int m_numChunksX;
+		int m_numChunksY;
+
+		Vec2f m_origin;
+		Vec2f m_tileDims;
+
+		std::vector<bool> m_tiles;
+
+		struct TileRect
+		{
+			int m_x, m_y;
+			int m_width, m_height;
+		};
+
+		// Hulls overlapping each chunk, a hull joined across seams is in the lists of all its chunks
+		std::vector<std::vector<ConvexHull*>> m_chunkHulls;
+		std::vector<bool> m_chunkDirty;
+
+		std::unordered_map<ConvexHull*, TileRect> m_hullRects;
+
+		// Adds the rectangles of the solid tiles of the chunk
+		void MergeChunk(int chunkX, int chunkY, std::vector<TileRect> &rects);
+
+		// Joins rectangles that share a complete edge, since their union is still convex
+		void JoinRects(std::vector<TileRect> &rects);
+
+		void AddHull(const TileRect &rect);
+
+		// Removes the hull from the light system. Its parts in chunks that are not dirty are added to the rectangles, to be joined again
+		void RemoveHull(ConvexHull* pHull, std::vector<TileRect> &rects);
+
+		ConvexHull* CreateHull(const TileRect &rect);
+
+	public:
+		HullTileMap();
+		HullTileMap(LightSystem* pLightSystem, int width, int height, const Vec2f &tileDims, const Vec2f &origin = Vec2f(0.0f, 0.0f), int chunkSize = 16);
+		~HullTileMap();
+
+		void Create(LightSystem* pLightSystem, int width, int height, const Vec2f &tileDims, const Vec2f &origin = Vec2f(0.0f, 0.0f), int chunkSize = 16);
+
+		// Marks the chunk containing the tile for re-merging if the tile changed
+		void SetTile(int x, int y, bool solid);
+		bool GetTile(int x, int y) const;
+
+		// Marks all chunks overlapping the tile region (inclusive) for re-merging
+		void InvalidateRegion(int lowerX, int lowerY, int upperX, int upperY);
+
+		// Re-merges all invalidated chunks and registers the resulting hulls with the light system
+		void Update();
+
+		// Removes all generated hulls from the light system
+		void Clear();
+
+		unsigned int GetNumHulls() const;
+	};
+}
+
+#endif
@@ -26,6 +26,7 @@
 #include <SFML/Graphics/RenderTexture.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
 
+#include <LTBL/Light/StaticLightAtlas.h>
 #include <LTBL/Constructs.h>
 #include <LTBL/QuadTree/QuadTree.h>
 
@@ -35,15 +36,29 @@ namespace ltbl
 		public qdt::QuadTreeOccupant
 	{
 	private:
-		sf::RenderTexture* m_pStaticTexture;
+		// Where the texture of a static light is cached. Allocated by the light system when the light is built
+		StaticLightAtlas::Region m_staticRegion;
+
+		// Last frame the cached texture was built or composited in, for evicting the least recently used lights
+		unsigned int m_staticFrame;
+
+		// Dynamic lights that are shown from a cached texture: the center and radius it was rendered with, the frame it was rendered in,
+		// and how far the hulls around the light moved since then
+		Vec2f m_cachedCenter;
+		float m_cachedRadius;
+		unsigned int m_cachedFrame;
+		float m_hullDrift;
+
+		// If the dynamic light was shown from its cached texture this frame
+		bool m_amortized;
+
+		// Center of a dynamic light in the previous frame it was visible in
+		Vec2f m_previousCenter;
 
 		bool m_alwaysUpdate;
 
 		sf::RenderWindow* m_pWin;
 
-		// Set up viewport information for the render texture
-		void SwitchStaticTexture();
-
 		bool m_updateRequired;
 
 	protected:
@@ -52,6 +67,9 @@ namespace ltbl
 		// Set to false in base classes in order to avoid shader attenuation
 		bool m_shaderAttenuation;
 
+		// Detail the light system renders the light with, from 1 (full) towards 0 for lights that are small on screen
+		float m_detail;
+
 	public:
 		Vec2f m_center;
 		float m_intensity;
@@ -78,6 +96,12 @@ namespace ltbl
 		virtual void RenderLightSolidPortion() = 0;
 		virtual void RenderLightSoftPortion() = 0;
 		virtual void CalculateAABB();
+
+		// Angles (radians) the light shines between, used by visibility polygon rendering. Defaults to all around
+		virtual void GetAngularRange(float &lowerAngle, float &upperAngle);
+
+		// False if RenderLightSoftPortion does not draw anything, which allows stencil rendering
+		virtual bool HasSoftPortion();
 		AABB* GetAABB();
 
 		bool AlwaysUpdate();
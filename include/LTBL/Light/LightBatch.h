@@ -0,0 +1,64 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_LIGHTBATCH_H
+#define LTBL_LIGHTBATCH_H
+
+#include <SFML/Graphics/Shader.hpp>
+
+#include <LTBL/Light/LightQuads.h>
+#include <LTBL/Constructs.h>
+
+namespace ltbl
+{
+	// Collects circular lights that do not need shadows, and draws them additively with a single call.
+	// Every light is a quad, which carries the light parameters in its vertex attributes, so one shader covers all of them
+	class LightBatch
+	{
+	private:
+		LightQuads m_quads;
+
+		sf::Shader m_shader;
+
+		bool m_available;
+
+	public:
+		LightBatch();
+
+		// Requires a valid context
+		void Create(bool useVertexBuffer);
+
+		// False if shaders are not supported
+		bool Available() const;
+
+		void Clear();
+		bool Empty() const;
+
+		// Center and radius in world units. The offset moves the center to the lower corner of the render target, the scale converts to its pixels
+		void AddLight(const Vec2f &center, float radius, const Color3f &color, float bleed, float linearizeFactor, const Vec2f &pixelOffset, float pixelScale = 1.0f);
+
+		// Draws all lights with the current blend function and transform, and clears the batch
+		void Render();
+	};
+}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+
+#ifndef LTBL_LIGHTQUADS_H
+#define LTBL_LIGHTQUADS_H
+
+#include <SFML/Graphics/Shader.hpp>
+
+#include <LTBL/Light/StreamBuffer.h>
+#include <LTBL/Constructs.h>
+
+#include <string>
+#include <vector>
+
+namespace ltbl
+{
+	// Quads around light disks for the shaders that draw many lights with one call.
+	// The vertices carry the light parameters as texture coordinates, which GetVertexShaderSource passes on to the fragment shader
+	class LightQuads
+	{
+	private:
+		struct Vertex
+		{
+			float m_x, m_y;
+
+			// Light center in pixels of the render target, and radius
+			float m_centerX, m_centerY, m_radius;
+
+			// Bleed, linearize factor, light size and a value of the user
+			float m_bleed, m_linearizeFactor, m_size, m_extra;
+
+			// Lower angle and angular extent
+			float m_lowerAngle, m_angleRange;
+
+			float m_r, m_g, m_b;
+		};
+
+		std::vector<Vertex> m_vertices;
+
+		StreamBuffer m_stream;
+
+	public:
+		// Requires a valid context
+		void Create(bool useVertexBuffer);
+
+		// Declares float Attenuation(float dist, float radius, float bleed, float linearizeFactor), the same as the light attenuation shader
+		static std::string GetAttenuationSource();
+
+		// Passes the light on in varying vec3 light (center, radius), vec4 params (bleed, linearize factor, size, user value) and vec2 range
+		static std::string GetVertexShaderSource();
+
+		void Clear();
+		bool Empty() const;
+
+		// Center and radius in world units. The offset moves the center to the lower corner of the render target, the scale converts to its pixels
+		void AddLight(const Vec2f &center, float radius, float size, const Color3f &color, float bleed, float linearizeFactor,
+			float lowerAngle, float upperAngle, float extra, const Vec2f &pixelOffset, float pixelScale);
+
+		// Draws all quads with the shader, the current blend function and transform
+		void Render(sf::Shader &shader);
+	};
+}
+
+#endif
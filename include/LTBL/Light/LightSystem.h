@@ -26,14 +26,32 @@
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/Graphics/RenderTexture.hpp>
 #include <SFML/Graphics/Shader.hpp>
+#include <SFML/System/Clock.hpp>
 
 #include <LTBL/QuadTree/StaticQuadTree.h>
 #include <LTBL/Light/Light.h>
 #include <LTBL/Light/EmissiveLight.h>
 #include <LTBL/Light/ConvexHull.h>
 #include <LTBL/Light/ShadowFin.h>
+#include <LTBL/Light/AngularCoverage.h>
+#include <LTBL/Light/ClipRegion.h>
+#include <LTBL/Light/ShadowUnion.h>
+#include <LTBL/Light/VisibilityPolygon.h>
+#include <LTBL/Light/ShadowBatch.h>
+#include <LTBL/Light/LightBatch.h>
+#include <LTBL/Light/PolarShadowMap.h>
+#include <LTBL/Light/TiledLightGrid.h>
+#include <LTBL/Light/DistanceField.h>
+#include <LTBL/Light/HullEdgeBuffer.h>
+#include <LTBL/Light/BloomPipeline.h>
+#include <LTBL/Light/EmissiveBatch.h>
+#include <LTBL/Light/StaticLightAtlas.h>
+#include <LTBL/Light/TextureFormat.h>
+#include <LTBL/Light/GPUTimer.h>
+#include <LTBL/Light/QualityGovernor.h>
 #include <LTBL/Constructs.h>
 
+#include <limits>
 #include <unordered_set>
 #include <vector>
 
@@ -50,6 +68,7 @@ namespace ltbl
 
 		std::unordered_set<ConvexHull*> m_convexHulls;
 
+		// Static lights passed to BuildLight that were not cached yet
 		std::vector<Light*> m_lightsToPreBuild;
 
 		qdt::StaticQuadTree m_lightTree;
@@ -64,13 +83,192 @@ namespace ltbl
 
 		sf::Texture m_softShadowTexture;
 
-		int m_prebuildTimer;
+		// Angular extent of a hull as seen from a light
+		struct HullOcclusionInfo
+		{
+			ConvexHull* m_pHull;
+
+			float m_lowerAngle;
+			float m_upperAngle;
+			float m_nearDistance;
+			float m_farDistance;
+
+			// False if the hull surrounds the light, or covers half of its view
+			bool m_bounded;
+
+			bool operator<(const HullOcclusionInfo &other) const;
+		};
+
+		std::vector<HullOcclusionInfo> m_hullOcclusionInfos;
+
+		AngularCoverage m_occlusionCoverage;
+
+		// Light disk intersected with the area the light is rendered to
+		ClipRegion m_shadowClipRegion;
+
+		std::vector<Vec2f> m_umbraStrip;
+
+		// Umbras of opaque hulls, merged before rendering
+		ShadowUnion m_shadowUnion;
+
+		VisibilityPolygon m_visibilityPolygon;
+
+		// Shadow geometry of the current light, submitted all at once
+		ShadowBatch m_shadowBatch;
+
+		// If GLEW could be initialized
+		bool m_extensionsLoaded;
+
+		// If the shadows of the current light go through the shadow batch
+		bool m_batchCurrentLight;
+
+		// Level of detail of the current light: extra fins per silhouette vertex, and if it casts hard shadows without fins
+		unsigned int m_maxFinsCurrentLight;
+		bool m_hardShadowsCurrentLight;
+
+		// Stencil attachment of the composition texture, 0 if there is none
+		unsigned int m_compositionStencilBuffer;
+		bool m_stencilAvailable;
+
+		// Light attenuation times the light that passes a fin
+		sf::Shader m_finStencilShader;
+
+		// Dynamic lights without hulls in range, drawn straight into the composition texture
+		LightBatch m_freeLightBatch;
+
+		// Bloom of the free lights, also of those drawn by the tiled grid
+		LightBatch m_bloomLightBatch;
+
+		// Dynamic lights without hulls in range, shaded per screen tile
+		TiledLightGrid m_tiledLightGrid;
+
+		// Rows of occluder distances for the dynamic lights shaded by shadow maps
+		PolarShadowMap m_shadowMap;
+
+		// Hulls in view as a distance field, for the dynamic lights shaded by cone marching
+		DistanceField m_distanceField;
+
+		// Edges of all hulls, for extruding the shadows on the GPU
+		HullEdgeBuffer m_hullEdgeBuffer;
+		std::vector<ConvexHull*> m_extrudedHulls;
+
+		// Thresholded, downsampled and blurred composition
+		BloomPipeline m_bloomPipeline;
+
+		// Visible emissive lights, drawn from a texture atlas
+		EmissiveBatch m_emissiveBatch;
+
+		// Cached textures of static lights
+		StaticLightAtlas m_staticLightAtlas;
+
+		// Formats the render textures currently have
+		TextureFormat m_appliedCompositionFormat;
+		TextureFormat m_appliedBloomFormat;
+		TextureFormat m_appliedLightMaskFormat;
+
+		// Tints the light temp texture, which holds a white light
+		sf::Shader m_lightMaskShader;
+		bool m_lightMaskShaderAvailable;
+
+		// Counts rendered frames, static lights remember the last frame they were composited in
+		unsigned int m_frame;
+
+		// Static light rebuilds done this frame, and the time since the first of them
+		unsigned int m_numStaticRebuilds;
+		sf::Clock m_staticRebuildClock;
+
+		// Lighting scale the render textures were created with
+		float m_appliedLightingScale;
+
+		// The distance field and bloom resources are only created once their feature is first enabled
+		bool m_distanceFieldCreated;
+		bool m_bloomCreated;
+
+		// Render texture pixels per view unit of the current frame
+		float m_pixelScale;
+
+		// Time spent in RenderLights on the CPU, and on the GPU as far as timer queries allow
+		sf::Clock m_lightingClock;
+		float m_lightingCPUTime;
+		GPUTimer m_gpuTimer;
+
+		// False if the light is inside of the hull
+		bool CastsShadow(Light* pLight, ConvexHull* pHull);
+
+		void MaskShadow(Light* light, ConvexHull* convexHull, bool minPoly, float depth, const ClipRegion* pClipRegion = NULL, bool renderUmbra = true);
+
+		// Masks off the shadows of all hulls of the current light
+		void MaskShadows(Light* pLight, const std::vector<qdt::QuadTreeOccupant*> &shadowHulls, const ClipRegion* pClipRegion, bool useVisibilityPolygon);
+
+		// Renders a light directly into the composition texture, with its umbras masked off in the stencil buffer
+		void RenderLightStencil(Light* pLight, const std::vector<qdt::QuadTreeOccupant*> &shadowHulls, const std::vector<qdt::QuadTreeOccupant*> &regionHulls,
+			const AABB &lightScreenRegion, const ClipRegion* pClipRegion, bool useVisibilityPolygon);
+
+		// If the dynamic light can be rendered straight into the composition texture
+		bool CanSkipLightTemp(Light* pLight);
+
+		// If a translucent hull of the ones in range of the light casts a shadow
+		bool CastsTranslucentShadow(Light* pLight, const std::vector<qdt::QuadTreeOccupant*> &regionHulls);
+
+		// Color times the intensity, clamped to 1 like the tint of cached lights, so a light looks the same on every path
+		Color3f GetLightTint(Light* pLight);
+
+		// The clamped composition loses the intensity above 1, so that part is added to the bloom texture.
+		// Black if bloom is off or the intensity is not above 1
+		Color3f GetBloomTint(Light* pLight);
 
-		void MaskShadow(Light* light, ConvexHull* convexHull, bool minPoly, float depth);
+		// Attaches a stencil buffer to the composition texture if the extensions allow it
+		void CreateCompositionStencil();
+
+		// Creates the lighting render textures at the window size times the lighting scale
+		void CreateRenderTextures();
+
+		// Creates the bloom texture and levels, keeps the shaders of the bloom pipeline
+		void CreateBloomTextures(unsigned int width, unsigned int height);
+
+		// Creates the distance field and bloom resources the first time their feature is enabled
+		void CreateFeatureResources();
+
+		// Recreates the render textures if the lighting scale changed
+		void ApplyLightingScale();
+
+		// Reallocates the render textures whose format setting changed
+		void ApplyTextureFormats();
+
+		// Texels per world unit the static lights are cached with at the current zoom
+		float GetStaticLightScale() const;
+
+		// Picks the level of detail of a light from its radius in render texture pixels
+		void SetLightDetail(Light* pLight, float screenRadius);
+
+		// If another static light that still has a cached texture may be rebuilt this frame
+		bool StaticRebuildBudgetLeft();
+
+		// Marks the cached static lights overlapping the region for rebuilding, and adds the hull drift to the cached dynamic lights
+		void InvalidateCachedLights(const AABB &region, float hullDrift = std::numeric_limits<float>::max());
+
+		// If the dynamic light moved little enough since the previous frame to be shown from a cached texture
+		bool IsSlowLight(Light* pLight);
+
+		// How much the cached texture of a dynamic light is off, in render texture pixels
+		float GetCachedLightError(Light* pLight);
+
+		// Invalidates the cached lights around the old and new bounds of every hull whose generation changed
+		void InvalidateChangedHulls();
+
+		// Finds atlas space for a static light within the texture budget. If allowed, evicts the least recently composited lights not in view.
+		// Lights prebuilt out of view should not evict, or under a full budget each prebuild only replaces the previous one
+		bool AllocateStaticRegion(Light* pLight, float scale, bool evict);
+
+		// Renders a triangle strip, clipped if a region is given
+		void RenderUmbraStrip(const std::vector<Vec2f> &strip, float depth, const ClipRegion* pClipRegion);
 
 		// Returns number of fins added
 		int AddExtraFins(const ConvexHull &hull, std::vector<ShadowFin> &fins, const Light &light, int boundryIndex, bool wrapCW, Vec2f &mainUmbraRoot, Vec2f &mainUmbraVec);
 
+		// Sorts the hulls nearest-first, and leaves out those that are hidden in the umbra of nearer opaque hulls
+		void CullOccludedHulls(Light* pLight, const std::vector<qdt::QuadTreeOccupant*> &regionHulls, std::vector<qdt::QuadTreeOccupant*> &shadowHulls);
+
 		void CameraSetup();
 		void SetUp(const AABB &region);
 
@@ -89,16 +287,109 @@ namespace ltbl
 
 		void ClearLightTexture(sf::RenderTexture &renTex);
 
+		// Light AABB in whole view units relative to the view, clamped to the view
+		AABB GetLightScreenRegion(Light* pLight);
+
+		// Sets the scissor rectangle to the render texture pixels covering the screen region
+		void ScissorScreenRegion(const AABB &screenRegion);
+
+		// Draws the part of the light temp texture that lies in the region
+		void RenderLightTempRegion(const AABB &screenRegion);
+
 	public:
 		AABB m_viewAABB;
 
 		sf::Color m_ambientColor;
 
 		bool m_checkForHullIntersect;
+
+		// Blur the parts of the composition brighter than the threshold, together with emissive lights of intensity above 1
+		// and the intensity above 1 of the other lights, and add them on top of the lighting
 		bool m_useBloom;
+		float m_bloomThreshold;
+		BloomPipeline::Quality m_bloomQuality;
+
+		// Skip shadows of hulls that lie completely in the shadow of other hulls
+		bool m_useOcclusionCulling;
+
+		// Clip shadow geometry to the light disk and the view, so it is not rasterized where it has no effect
+		bool m_clipShadows;
+
+		// Merge the umbras of all opaque hulls of a light into non-overlapping polygons on the CPU before rendering
+		bool m_unionShadows;
+
+		// Render lights as their visibility polygon instead of masking the full light shape with the umbras of opaque hulls
+		bool m_useVisibilityPolygons;
+
+		// Collect the umbras and fins of a light in one vertex buffer, and draw them with one call per blend function
+		bool m_batchShadows;
+
+		// Clear, render and composite dynamic lights only within their screen space AABB
+		bool m_scissorLights;
+
+		// Render dynamic lights without soft portion and translucent hulls straight into the composition texture,
+		// masking their umbras with the stencil buffer instead of going through the light temp texture
+		bool m_useStencilShadows;
+
+		// Draw dynamic lights without any hulls in range all at once, straight into the composition texture
+		bool m_batchFreeLights;
+
+		// Shade the lights without hulls in range per screen tile in one pass, so every pixel is blended only once.
+		// Lights that do not fit in the grid are drawn with the batch
+		bool m_tileFreeLights;
+
+		// Shade dynamic lights with polar shadow maps in one pass, instead of masking each light with shadow geometry.
+		// Lights with a soft portion, lights behind translucent hulls, and lights beyond the capacity of the shadow map, still use shadow geometry
+		bool m_useShadowMaps;
+
+		// Shade dynamic lights by marching through a distance field of the hulls in view, so the cost does not depend on the hull count.
+		// Takes precedence over shadow maps. Lights with a soft portion, and lights behind translucent hulls, still use shadow geometry
+		bool m_useDistanceField;
+
+		// Extrude umbras and fins in vertex shaders from a buffer of all hull edges, instead of building them on the CPU for every light and hull.
+		// Only the first fin of each silhouette vertex is rendered, m_maxFins is ignored
+		bool m_extrudeShadows;
 
 		unsigned int m_maxFins;
 
+		// Reduce the fan subdivisions, extra fins and penumbras of lights that are small on screen. Lights get full detail above a
+		// screen radius of 256 pixels divided by the quality, and hard shadows without fins below a eighth of that
+		bool m_useLightLOD;
+		float m_lightQuality;
+
+		// Storage of the composition texture, and of the bloom textures. A float format lets the lighting exceed 1 before bloom
+		TextureFormat m_compositionFormat;
+		TextureFormat m_bloomFormat;
+
+		// Storage of the light temp texture and the cached static lights. Lights are rendered white into them and tinted when
+		// composited, so a single channel format is enough
+		TextureFormat m_lightMaskFormat;
+
+		// Resolution of the lighting render textures relative to the window. Below 1 the lighting is rendered
+		// at lower resolution and upsampled bilinearly by RenderLightTexture
+		float m_lightingScale;
+
+		// Rebuilds of cached static lights per frame, by count and by milliseconds spent. 0 for no limit.
+		// Lights are rebuilt nearest to the view center first, the others keep showing their old texture until a later frame.
+		// Visible lights without any texture are always built, queued lights out of view only within the budget
+		unsigned int m_maxStaticRebuilds;
+		float m_staticRebuildTime;
+
+		// Texture memory the cached static lights may use, in bytes. 0 for no limit.
+		// Lights that do not fit are rendered like dynamic lights
+		unsigned int m_staticTextureBudget;
+
+		// Dynamic lights that moved less than this many render texture pixels since the previous frame are rendered into the static light atlas,
+		// and shown from there until they, or the hulls around them, changed by more than that in total. Those are rendered again oldest first,
+		// at most m_maxDynamicRebuilds per frame (0 for no limit). 0 renders every dynamic light every frame
+		float m_dynamicUpdateThreshold;
+		unsigned int m_maxDynamicRebuilds;
+
+		// Let the governor set m_lightingScale, m_maxFins, m_lightQuality, m_useBloom and m_dynamicUpdateThreshold from the lighting time of the last frames.
+		// The fields show the settings it chose, its levels and target time can be changed through it
+		bool m_useGovernor;
+		QualityGovernor m_governor;
+
 		LightSystem();
 		LightSystem(const AABB &region, sf::RenderWindow* pRenderWindow, const std::string &finImagePath, const std::string &lightAttenuationShaderPath);
 		~LightSystem();
@@ -116,18 +407,25 @@ namespace ltbl
 		void RemoveConvexHull(ConvexHull* pHull);
 		void RemoveEmissiveLight(EmissiveLight* pEmissiveLight);
 
-		// Pre-builds the light
+		// Queues the static light to be cached before it comes into view, within the rebuild budget
 		void BuildLight(Light* pLight);
 
 		void ClearLights();
 		void ClearConvexHulls();
 		void ClearEmissiveLights();
 
+		// Emissive textures are copied into an atlas when first seen. Call this after changing their contents, or reusing freed textures
+		void RefreshEmissiveTextures();
+
 		// Renders lights to the light texture
 		void RenderLights();
 
 		void RenderLightTexture();
 
+		// Milliseconds the last RenderLights took on the CPU, and on the GPU. The GPU time is a few frames old, and 0 without timer queries
+		float GetLightingCPUTime() const;
+		float GetLightingGPUTime() const;
+
 		void DebugRender();
 	};
 }
@@ -51,6 +51,8 @@ namespace ltbl
 		void RenderLightSolidPortion();
 		void RenderLightSoftPortion();
 		void CalculateAABB();
+		void GetAngularRange(float &lowerAngle, float &upperAngle);
+		bool HasSoftPortion();
 	};
 }
 
@@ -0,0 +1,107 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_POLARSHADOWMAP_H
+#define LTBL_POLARSHADOWMAP_H
+
+#include <SFML/Graphics/Shader.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include <LTBL/Light/ConvexHull.h>
+#include <LTBL/Light/LightQuads.h>
+#include <LTBL/Light/RenderTargetUtils.h>
+#include <LTBL/Constructs.h>
+
+#include <vector>
+
+namespace ltbl
+{
+	// Shadow backend for many small lights. Every light gets a row of a texture, holding the distance to
+	// the nearest occluder for each angle around the light. All lights are then shaded with one draw,
+	// which compares the fragment distance with the row, and blurs it by the light size for the penumbra.
+	class PolarShadowMap
+	{
+	private:
+		// The user value of each light is the texture coordinate of its row
+		LightQuads m_quads[num_lightTargets];
+
+		unsigned int m_resolution;
+		unsigned int m_maxLights;
+		unsigned int m_numLights;
+
+		// Distance to the nearest occluder relative to the radius
+		std::vector<float> m_distances;
+
+		// Direction through the center of each angle bin
+		std::vector<Vec2f> m_binDirections;
+
+		// Current light
+		Vec2f m_center;
+		float m_radius;
+
+		std::vector<sf::Uint8> m_pixels;
+
+		sf::Texture m_texture;
+		sf::Shader m_shader;
+
+		// If the rows of the current lights are in the texture
+		bool m_uploaded;
+
+		bool m_available;
+
+		void AddEdge(const Vec2f &start, const Vec2f &end);
+
+		// Stores the distances of the current light in its row of pixels
+		void EncodeRow();
+
+	public:
+		PolarShadowMap();
+
+		// Requires a valid context. Resolution is the number of angles per light
+		void Create(bool useVertexBuffer, unsigned int resolution = 512, unsigned int maxLights = 128);
+
+		// False if shaders are not supported
+		bool Available() const;
+
+		// True if no more lights fit in this frame
+		bool Full() const;
+
+		void Clear();
+		bool Empty() const;
+
+		// Starts the row of a new light. Lights with a bloom color other than black are drawn into the bloom texture as well.
+		// The offset moves the center to the lower corner of the render target, the scale converts to its pixels
+		void BeginLight(const Vec2f &center, float radius, float size, const Color3f &color, const Color3f &bloomColor, float bleed, float linearizeFactor,
+			float lowerAngle, float upperAngle, const Vec2f &pixelOffset, float pixelScale = 1.0f);
+
+		// Adds the hull to the current light. Hulls are treated as opaque, with light over hull only the far side blocks the light
+		void AddHull(const ConvexHull &hull);
+
+		void EndLight();
+
+		// Uploads the rows, and draws the lights of the target with the current blend function and transform.
+		// Clears the map once the lights of both targets are drawn
+		void Render(LightTarget target);
+	};
+}
+
+#endif
@@ -0,0 +1,83 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_QUALITYGOVERNOR_H
+#define LTBL_QUALITYGOVERNOR_H
+
+#include <vector>
+
+namespace ltbl
+{
+	// Picks a quality level from the measured lighting time. Drops a level when the averaged time exceeds the target,
+	// and only raises it again when the time stays below the target by the hysteresis margin for longer
+	class QualityGovernor
+	{
+	public:
+		// Knobs of one quality level, applied to the light system
+		struct Settings
+		{
+			float m_lightingScale;
+			unsigned int m_maxFins;
+			float m_lightQuality;
+			bool m_useBloom;
+			float m_dynamicUpdateThreshold;
+
+			Settings(float lightingScale, unsigned int maxFins, float lightQuality, bool useBloom, float dynamicUpdateThreshold);
+		};
+
+	private:
+		unsigned int m_level;
+
+		// Exponential moving average of the lighting time, in milliseconds
+		float m_averageTime;
+
+		unsigned int m_framesSinceChange;
+
+	public:
+		// Highest quality first
+		std::vector<Settings> m_levels;
+
+		// Milliseconds the lighting may take per frame
+		float m_targetTime;
+
+		// Fraction below the target the time has to stay at before the quality is raised
+		float m_hysteresis;
+
+		// Frames to measure after a change before lowering again. Raising waits four times as long
+		unsigned int m_settleFrames;
+
+		QualityGovernor();
+
+		// Adds the lighting time of a frame. Returns true if the level changed
+		bool Update(float lightingTime);
+
+		// Back to the highest quality
+		void Reset();
+
+		unsigned int GetLevel() const;
+		const Settings &GetSettings() const;
+
+		float GetAverageTime() const;
+	};
+}
+
+#endif
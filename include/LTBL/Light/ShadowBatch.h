@@ -0,0 +1,102 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_SHADOWBATCH_H
+#define LTBL_SHADOWBATCH_H
+
+#include <SFML/Graphics/Texture.hpp>
+
+#include <LTBL/Light/ClipRegion.h>
+#include <LTBL/Light/StreamBuffer.h>
+#include <LTBL/Constructs.h>
+
+#include <vector>
+
+namespace ltbl
+{
+	// Collects the shadow geometry of a light, and submits it with one draw per blend function
+	class ShadowBatch
+	{
+	public:
+		enum BlendMode
+		{
+			// Umbras of opaque hulls. Blended like blend_multiply, but kept apart for stencil rendering
+			blend_umbra,
+			// Destination is multiplied by the source alpha
+			blend_multiply,
+			// Destination is multiplied by one minus the source alpha
+			blend_multiplyInverse,
+			num_blendModes
+		};
+
+	private:
+		struct Vertex
+		{
+			float m_x, m_y, m_z;
+			float m_u, m_v;
+			float m_r, m_g, m_b, m_a;
+		};
+
+		std::vector<Vertex> m_vertices[num_blendModes];
+
+		// All lists after another, as uploaded
+		std::vector<Vertex> m_uploadVertices;
+		unsigned int m_uploadOffsets[num_blendModes + 1];
+
+		StreamBuffer m_stream;
+
+		std::vector<Vec2f> m_tempPositions;
+		std::vector<Vec2f> m_tempTexCoords;
+
+		void AddVertex(BlendMode mode, const Vec2f &position, const Vec2f &texCoord, float depth, float alpha);
+
+	public:
+		// Requires a valid context
+		void Create(bool useVertexBuffer);
+
+		void Clear();
+
+		bool Empty() const;
+		bool Empty(BlendMode mode) const;
+
+		// Adds a convex polygon as a triangle fan
+		void AddPolygon(BlendMode mode, const std::vector<Vec2f> &positions, const std::vector<Vec2f> &texCoords, float depth, float alpha);
+		void AddPolygon(BlendMode mode, const std::vector<Vec2f> &positions, const Vec2f &texCoord, float depth, float alpha);
+
+		// Adds a triangle strip, clipped if a region is given
+		void AddTriangleStrip(BlendMode mode, const std::vector<Vec2f> &strip, const Vec2f &texCoord, float depth, float alpha, const ClipRegion* pClipRegion);
+
+		// Uploads all lists and sets up the vertex arrays for Draw
+		void Upload();
+
+		// Draws the lists from first to last (inclusive) with the current render state
+		void Draw(BlendMode first, BlendMode last);
+
+		// Resets the vertex arrays after drawing, and clears the batch
+		void Finish();
+
+		// Draws everything with the texture and the matching blend functions, and clears the batch
+		void Render(const sf::Texture* pTexture);
+	};
+}
+
+#endif
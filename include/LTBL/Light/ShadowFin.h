@@ -24,11 +24,16 @@
 
 #include <SFML/OpenGL.hpp>
 #include <LTBL/Constructs/Vec2f.h>
+#include <LTBL/Light/ClipRegion.h>
+#include <LTBL/Light/ShadowBatch.h>
 
 namespace ltbl
 {
 	class ShadowFin
 	{
+	private:
+		void RenderTriangle(const Vec2f &rootTexCoord, const Vec2f &penumbraTexCoord, const Vec2f &umbraTexCoord, const ClipRegion* pClipRegion);
+
 	public:
 		Vec2f m_rootPos;
 		Vec2f m_umbra;
@@ -40,7 +45,11 @@ namespace ltbl
 		ShadowFin();
 		~ShadowFin();
 
-		void Render(float transparency);
+		// Only renders the part inside of the clip region, if one is given
+		void Render(float transparency, const ClipRegion* pClipRegion = NULL);
+
+		// Same as Render, but adds the fin to the batch instead of drawing it
+		void AddToBatch(ShadowBatch &batch, float transparency, const ClipRegion* pClipRegion = NULL);
 	};
 }
 
@@ -0,0 +1,82 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_SHADOWUNION_H
+#define LTBL_SHADOWUNION_H
+
+#include <LTBL/Light/ClipRegion.h>
+#include <LTBL/Light/ShadowBatch.h>
+#include <LTBL/Constructs.h>
+
+#include <vector>
+
+namespace ltbl
+{
+	// Accumulates umbra geometry as a set of non-overlapping convex polygons,
+	// so that overlapping shadows do not darken the same pixels multiple times
+	class ShadowUnion
+	{
+	private:
+		struct Polygon
+		{
+			std::vector<Vec2f> m_vertices;
+
+			AABB m_aabb;
+
+			void CalculateAABB();
+		};
+
+		std::vector<Polygon> m_pieces;
+
+		// Scratch space
+		std::vector<Polygon> m_remaining;
+		std::vector<Polygon> m_nextRemaining;
+		std::vector<Vec2f> m_positions;
+		std::vector<Vec2f> m_tempPositions;
+		std::vector<Vec2f> m_noTexCoords;
+		std::vector<Vec2f> m_tempTexCoords;
+
+		// Adds the parts of the polygon that are outside of the other polygon to the result
+		void Subtract(const Polygon &polygon, const Polygon &other, std::vector<Polygon> &result);
+
+		static float SignedArea(const std::vector<Vec2f> &vertices);
+
+	public:
+		void Clear();
+
+		bool Empty() const;
+
+		// Adds the part of the convex polygon that is not covered yet
+		void AddConvexPolygon(const std::vector<Vec2f> &vertices);
+
+		// Adds an umbra triangle strip, split into convex pieces and clipped if a region is given
+		void AddStrip(const std::vector<Vec2f> &strip, const ClipRegion* pClipRegion);
+
+		// Renders the pieces with the current color and blend function
+		void Render(float depth);
+
+		// Adds the pieces as fully dark umbra to the batch
+		void AddToBatch(ShadowBatch &batch, const Vec2f &texCoord, float depth);
+	};
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_STATICLIGHTATLAS_H
+#define LTBL_STATICLIGHTATLAS_H
+
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <SFML/Graphics/Shader.hpp>
+
+#include <LTBL/Light/RenderTargetUtils.h>
+#include <LTBL/Light/StreamBuffer.h>
+#include <LTBL/Light/TextureFormat.h>
+#include <LTBL/Constructs.h>
+
+#include <vector>
+
+namespace ltbl
+{
+	// Shared render texture pages for the cached textures of static lights. Regions are allocated on shelves,
+	// and the cached lights of a page are composited with one draw call
+	class StaticLightAtlas
+	{
+	public:
+		struct Region
+		{
+			// -1 if not allocated
+			int m_page;
+
+			unsigned int m_x, m_y;
+			unsigned int m_width, m_height;
+
+			// Texels per world unit
+			float m_scale;
+
+			Region();
+		};
+
+	private:
+		struct Span
+		{
+			unsigned int m_x, m_width;
+		};
+
+		struct Shelf
+		{
+			unsigned int m_y, m_height;
+
+			// Sorted by x
+			std::vector<Span> m_freeSpans;
+		};
+
+		struct Vertex
+		{
+			float m_x, m_y;
+			float m_u, m_v;
+			float m_r, m_g, m_b;
+		};
+
+		struct Page
+		{
+			sf::RenderTexture m_texture;
+
+			std::vector<Shelf> m_shelves;
+			unsigned int m_nextShelfY;
+
+			unsigned int m_numRegions;
+
+			// Bytes per texel of the format the page ended up with
+			unsigned int m_texelSize;
+
+			std::vector<Vertex> m_compositeVertices[num_lightTargets];
+		};
+
+		std::vector<Page*> m_pages;
+
+		unsigned int m_pageSize;
+
+		TextureFormat m_format;
+
+		// Tints the red channel of the pages. Without shaders the pages stay RGBA8 and are tinted by the vertex colors
+		sf::Shader m_compositeShader;
+		bool m_compositeShaderAvailable;
+
+		StreamBuffer m_stream;
+
+		Page* CreatePage(unsigned int width, unsigned int height);
+
+		bool AllocateInPage(Page* pPage, unsigned int width, unsigned int height, Region &region);
+
+	public:
+		StaticLightAtlas();
+		~StaticLightAtlas();
+
+		// Requires a valid context
+		void Create(bool useVertexBuffer);
+
+		// Format of new pages. Frees all regions and pages if it changes, returns true in that case
+		bool SetFormat(TextureFormat format);
+
+		// Finds space for a light texture, adding a page if needed and allowed. Returns false if there is no space
+		bool Allocate(unsigned int width, unsigned int height, Region &region, bool allowNewPage = true);
+		void Free(Region &region);
+
+		// Frees all regions and pages
+		void Clear();
+
+		// Activates the page, restricts rendering to the region and clears it. Coordinates are world units from the top left corner of the region
+		void BeginRegion(const Region &region);
+		void EndRegion(const Region &region);
+
+		// Queues the region to be drawn at the lower bound (world units, sized by the region scale), tinted by the color times the intensity (clamped to 1)
+		void AddToComposite(const Region &region, const Vec2f &lowerBound, const Color3f &color, float intensity, LightTarget target);
+
+		// Draws all regions queued for the target with the current blend function and transform
+		void RenderComposite(LightTarget target);
+
+		unsigned int GetNumPages() const;
+
+		// Texture memory of all pages, and of the page that would be added for a light of the given size, in bytes
+		unsigned int GetMemoryUsage() const;
+		unsigned int GetNewPageMemory(unsigned int width, unsigned int height) const;
+	};
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+
+#ifndef LTBL_STREAMBUFFER_H
+#define LTBL_STREAMBUFFER_H
+
+namespace ltbl
+{
+	// Vertex buffer that is refilled for every draw. Falls back to client side arrays when vertex buffers are not supported
+	class StreamBuffer
+	{
+	private:
+		// 0 if not supported
+		unsigned int m_buffer;
+		unsigned int m_size;
+
+	public:
+		StreamBuffer();
+		~StreamBuffer();
+
+		// Requires a valid context. Pass false to use client side vertex arrays
+		void Create(bool useVertexBuffer);
+
+		// Uploads the vertices and leaves the buffer bound. Returns the base address for the gl*Pointer calls,
+		// which is NULL for the vertex buffer and the data itself for client side arrays
+		const char* Upload(const void* pData, unsigned int size);
+
+		// Unbinds the vertex buffer, call after the draws that used the uploaded data
+		void Unbind();
+	};
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_TEXTUREFORMAT_H
+#define LTBL_TEXTUREFORMAT_H
+
+#include <SFML/Graphics/RenderTexture.hpp>
+
+namespace ltbl
+{
+	// Storage of the render textures used by the light system.
+	// The single channel formats only keep the red channel, and are meant for light masks that are tinted when composited
+	enum TextureFormat
+	{
+		format_rgba8, format_rgb10a2, format_rgba16f, format_r8, format_r16f
+	};
+
+	// Requires a valid context with GLEW initialized
+	bool TextureFormatSupported(TextureFormat format);
+
+	// Bytes per texel
+	unsigned int GetTextureFormatSize(TextureFormat format);
+
+	// Reallocates the texture of the render texture with the format, discarding its contents. Falls back to RGBA8 and returns false
+	// if the format is not supported or not renderable. Leaves the render texture active
+	bool SetRenderTextureFormat(sf::RenderTexture &renTex, TextureFormat format);
+}
+
+#endif
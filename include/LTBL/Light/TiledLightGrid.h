@@ -0,0 +1,97 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_TILEDLIGHTGRID_H
+#define LTBL_TILEDLIGHTGRID_H
+
+#include <SFML/Graphics/Shader.hpp>
+
+#include <LTBL/Constructs.h>
+
+#include <vector>
+
+namespace ltbl
+{
+	// Shades many unshadowed lights in one pass. Lights are binned into screen tiles on the CPU,
+	// the light parameters and the per-tile light lists are uploaded as float textures,
+	// and every pixel sums the attenuation of the lights in its tile, so it is blended only once
+	class TiledLightGrid
+	{
+	private:
+		unsigned int m_tileSize;
+		unsigned int m_numTilesX;
+		unsigned int m_numTilesY;
+
+		unsigned int m_maxLights;
+		unsigned int m_maxLightsPerTile;
+
+		// Light parameters, two texels per light: center, radius and bleed, then color and linearize factor
+		std::vector<float> m_lightData;
+		std::vector<float> m_lightUpload;
+		unsigned int m_numLights;
+
+		std::vector<std::vector<float>> m_tileLights;
+		std::vector<unsigned int> m_tileIndices;
+
+		// Flattened tile lists, and offset and count per tile
+		std::vector<float> m_indices;
+		unsigned int m_numIndices;
+		std::vector<float> m_tileHeaders;
+
+		unsigned int m_indexTextureWidth;
+		unsigned int m_indexTextureHeight;
+
+		unsigned int m_lightTexture;
+		unsigned int m_tileTexture;
+		unsigned int m_indexTexture;
+
+		sf::Shader m_shader;
+
+		bool m_available;
+
+		void CreateTexture(unsigned int &texture, int internalFormat, unsigned int width, unsigned int height);
+
+	public:
+		TiledLightGrid();
+		~TiledLightGrid();
+
+		// Requires a valid context and float textures
+		void Create(unsigned int tileSize = 32, unsigned int maxLights = 1024, unsigned int maxLightsPerTile = 64);
+
+		// False if shaders or float textures are not supported
+		bool Available() const;
+
+		// Sets up the tiles for the size of the render target in pixels, and clears the lights
+		void Begin(const Vec2f &targetSize);
+
+		bool Empty() const;
+
+		// Center and radius in pixels of the render target.
+		// Returns false if the light did not fit, because the grid, the index texture or one of its tiles is full
+		bool AddLight(const Vec2f &center, float radius, const Color3f &color, float bleed, float linearizeFactor);
+
+		// Uploads the lists and draws all tiles that have lights, with the current blend function, in pixel coordinates
+		void Render();
+	};
+}
+
+#endif
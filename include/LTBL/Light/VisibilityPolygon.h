@@ -0,0 +1,111 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef LTBL_VISIBILITYPOLYGON_H
+#define LTBL_VISIBILITYPOLYGON_H
+
+#include <LTBL/Light/ConvexHull.h>
+#include <LTBL/Constructs.h>
+
+#include <vector>
+#include <set>
+
+namespace ltbl
+{
+	// Region visible from a point within a radius, found with an angular sweep over hull edges.
+	// Stored as a triangle fan around the point.
+	class VisibilityPolygon
+	{
+	private:
+		struct Segment
+		{
+			// Counter clockwise around the center
+			Vec2f m_start;
+			Vec2f m_end;
+
+			float m_startAngle;
+			float m_endAngle;
+		};
+
+		// Start or end of a segment, at an angle relative to the lower angle of the sweep
+		struct Event
+		{
+			float m_angle;
+			unsigned int m_segment;
+			bool m_insert;
+
+			// Ends before starts at the same angle
+			bool operator<(const Event &other) const;
+		};
+
+		// Orders the active segments by distance along the sweep direction. Segments do not cross
+		// unless hulls overlap, so an order taken at one angle holds for as long as both are active
+		struct CloserSegment
+		{
+			const VisibilityPolygon* m_pPolygon;
+
+			CloserSegment(const VisibilityPolygon* pPolygon);
+
+			bool operator()(unsigned int first, unsigned int second) const;
+		};
+
+		typedef std::set<unsigned int, CloserSegment> ActiveSegments;
+
+		Vec2f m_center;
+		float m_radius;
+
+		std::vector<Segment> m_segments;
+		std::vector<Event> m_events;
+
+		// Where each active segment is in the active set
+		std::vector<ActiveSegments::iterator> m_activePositions;
+
+		Vec2f m_sweepDirection;
+
+		std::vector<Vec2f> m_vertices;
+
+		// Distance from the center to the line of the segment along the direction
+		float GetDistance(unsigned int segment, const Vec2f &direction) const;
+
+		// Adds the point of the nearest active segment at the angle, at most the radius away
+		void AddBoundaryVertex(const ActiveSegments &activeSegments, float angle);
+
+	public:
+		VisibilityPolygon();
+
+		void Begin(const Vec2f &center, float radius);
+
+		// With light over hull, only the far side of the hull blocks the light, so the hull itself is lit
+		void AddHull(const ConvexHull &hull, bool lightOverHull);
+
+		// Sweeps from the lower to the upper angle (radians) over the segment ends, keeping the segments the sweep
+		// direction crosses ordered by distance. Adds boundary vertices at the segment ends and at least every subdivision.
+		// O(E log E) in the number of edges
+		void Compute(float lowerAngle, float upperAngle, float subdivisionSize);
+
+		const std::vector<Vec2f> &GetVertices() const;
+
+		void Render();
+	};
+}
+
+#endif
@@ -0,0 +1,112 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <LTBL/Light/AngularCoverage.h>
+#include <LTBL/Utils.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace ltbl
+{
+	bool AngularCoverage::Interval::operator<(const Interval &other) const
+	{
+		return m_lower < other.m_lower;
+	}
+
+	void AngularCoverage::Clear()
+	{
+		m_intervals.clear();
+	}
+
+	void AngularCoverage::Add(float lowerAngle, float upperAngle, float distance)
+	{
+		if(upperAngle <= lowerAngle || upperAngle - lowerAngle >= pifTimes2)
+			return;
+
+		// Bring lower angle into [-pi, pi)
+		float offset = std::floor((lowerAngle + pif) / pifTimes2) * pifTimes2;
+		lowerAngle -= offset;
+		upperAngle -= offset;
+
+		Interval interval;
+		interval.m_distance = distance;
+		interval.m_lower = lowerAngle;
+
+		if(upperAngle > pif)
+		{
+			// Split the interval where it wraps around
+			interval.m_upper = pif;
+			m_intervals.push_back(interval);
+
+			interval.m_lower = -pif;
+			interval.m_upper = upperAngle - pifTimes2;
+		}
+		else
+			interval.m_upper = upperAngle;
+
+		m_intervals.push_back(interval);
+	}
+
+	bool AngularCoverage::Covered(float lowerAngle, float upperAngle, float distance) const
+	{
+		if(m_intervals.empty() || upperAngle < lowerAngle || upperAngle - lowerAngle >= pifTimes2)
+			return false;
+
+		float offset = std::floor((lowerAngle + pif) / pifTimes2) * pifTimes2;
+		lowerAngle -= offset;
+		upperAngle -= offset;
+
+		if(upperAngle > pif)
+			return CoveredWrapped(lowerAngle, pif, distance) && CoveredWrapped(-pif, upperAngle - pifTimes2, distance);
+
+		return CoveredWrapped(lowerAngle, upperAngle, distance);
+	}
+
+	bool AngularCoverage::CoveredWrapped(float lower, float upper, float distance) const
+	{
+		// Only intervals that end before the queried distance occlude it
+		m_query.clear();
+
+		for(unsigned int i = 0, numIntervals = m_intervals.size(); i < numIntervals; i++)
+			if(m_intervals[i].m_distance <= distance && m_intervals[i].m_upper >= lower && m_intervals[i].m_lower <= upper)
+				m_query.push_back(m_intervals[i]);
+
+		std::sort(m_query.begin(), m_query.end());
+
+		// Sweep, extending the covered range until a gap is found
+		float covered = lower;
+
+		for(unsigned int i = 0, numIntervals = m_query.size(); i < numIntervals; i++)
+		{
+			if(m_query[i].m_lower > covered)
+				return false;
+
+			covered = std::max(covered, m_query[i].m_upper);
+
+			if(covered >= upper)
+				return true;
+		}
+
+		return false;
+	}
+}
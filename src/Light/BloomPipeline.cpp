@@ -0,0 +1,236 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <LTBL/Light/BloomPipeline.h>
+#include <LTBL/Light/RenderTargetUtils.h>
+
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+#include <string>
+
+namespace ltbl
+{
+	BloomPipeline::BloomPipeline()
+		: m_numLevels(0), m_shadersLoaded(false), m_available(false)
+	{
+	}
+
+	void BloomPipeline::Create()
+	{
+		m_shadersLoaded = false;
+
+		if(!sf::Shader::isAvailable())
+			return;
+
+		const std::string brightPassShaderSource =
+			"uniform sampler2D composition;\n"
+			"uniform sampler2D extraBloom;\n"
+			"uniform vec2 targetSize;\n"
+			"uniform float threshold;\n"
+			"void main()\n"
+			"{\n"
+			"	vec2 texCoord = gl_FragCoord.xy / targetSize;\n"
+			"	vec3 bright = max(texture2D(composition, texCoord).rgb - threshold, 0.0) / max(1.0 - threshold, 0.0001);\n"
+			"	gl_FragColor = vec4(bright + texture2D(extraBloom, texCoord).rgb, 1.0);\n"
+			"}\n";
+
+		// 9 tap Gaussian in 5 lookups, using linear filtering between the outer taps
+		const std::string blurShaderSource =
+			"uniform sampler2D source;\n"
+			"uniform vec2 targetSize;\n"
+			"uniform vec2 direction;\n"
+			"void main()\n"
+			"{\n"
+			"	vec2 texCoord = gl_FragCoord.xy / targetSize;\n"
+			"	vec2 nearOffset = direction * 1.3846153846 / targetSize;\n"
+			"	vec2 farOffset = direction * 3.2307692308 / targetSize;\n"
+			"	vec4 color = texture2D(source, texCoord) * 0.2270270270;\n"
+			"	color += (texture2D(source, texCoord + nearOffset) + texture2D(source, texCoord - nearOffset)) * 0.3162162162;\n"
+			"	color += (texture2D(source, texCoord + farOffset) + texture2D(source, texCoord - farOffset)) * 0.0702702703;\n"
+			"	gl_FragColor = color;\n"
+			"}\n";
+
+		const std::string copyShaderSource =
+			"uniform sampler2D source;\n"
+			"uniform vec2 targetSize;\n"
+			"void main()\n"
+			"{\n"
+			"	gl_FragColor = texture2D(source, gl_FragCoord.xy / targetSize);\n"
+			"}\n";
+
+		m_shadersLoaded = m_brightPassShader.loadFromMemory(brightPassShaderSource, sf::Shader::Fragment) &&
+			m_blurShader.loadFromMemory(blurShaderSource, sf::Shader::Fragment) &&
+			m_copyShader.loadFromMemory(copyShaderSource, sf::Shader::Fragment);
+	}
+
+	void BloomPipeline::Resize(unsigned int width, unsigned int height)
+	{
+		m_available = false;
+		m_numLevels = 0;
+
+		if(!m_shadersLoaded)
+			return;
+
+		for(int i = 0; i < s_maxLevels; i++)
+		{
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+
+			if(!m_levels[i].create(width, height, false) || !m_blurLevels[i].create(width, height, false))
+				return;
+
+			// Smooth, so the downsampling and upsampling filter
+			m_levels[i].setSmooth(true);
+			m_blurLevels[i].setSmooth(true);
+
+			m_numLevels++;
+		}
+
+		m_available = true;
+	}
+
+	void BloomPipeline::SetFormat(TextureFormat format)
+	{
+		for(int i = 0; i < m_numLevels; i++)
+		{
+			SetRenderTextureFormat(m_levels[i], format);
+			SetRenderTextureFormat(m_blurLevels[i], format);
+		}
+	}
+
+	bool BloomPipeline::Available() const
+	{
+		return m_available;
+	}
+
+	void BloomPipeline::BeginPass(sf::RenderTexture &target)
+	{
+		target.setActive();
+
+		sf::Vector2u size(target.getSize());
+
+		glViewport(0, 0, size.x, size.y);
+
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		glOrtho(0, size.x, 0, size.y, -100.0f, 100.0f);
+		glMatrixMode(GL_MODELVIEW);
+		glLoadIdentity();
+
+		glDisable(GL_BLEND);
+	}
+
+	void BloomPipeline::Render(const sf::Texture &composition, const sf::Texture &extraBloom, float threshold, Quality quality)
+	{
+		if(!m_available)
+			return;
+
+		// Each quality step doubles the glow radius
+		const int numLevels = std::min(quality == quality_low ? 2 : (quality == quality_medium ? 4 : 6), m_numLevels);
+
+		// Bright pass into the first level
+		BeginPass(m_levels[0]);
+
+		m_brightPassShader.setParameter("composition", composition);
+		m_brightPassShader.setParameter("extraBloom", extraBloom);
+		m_brightPassShader.setParameter("targetSize", static_cast<float>(m_levels[0].getSize().x), static_cast<float>(m_levels[0].getSize().y));
+		m_brightPassShader.setParameter("threshold", threshold);
+
+		sf::Shader::bind(&m_brightPassShader);
+		RenderFullTarget(m_levels[0]);
+		sf::Shader::bind(NULL);
+
+		m_levels[0].display();
+
+		// Downsample
+		for(int i = 1; i < numLevels; i++)
+		{
+			BeginPass(m_levels[i]);
+
+			m_copyShader.setParameter("source", m_levels[i - 1].getTexture());
+			m_copyShader.setParameter("targetSize", static_cast<float>(m_levels[i].getSize().x), static_cast<float>(m_levels[i].getSize().y));
+
+			sf::Shader::bind(&m_copyShader);
+			RenderFullTarget(m_levels[i]);
+			sf::Shader::bind(NULL);
+
+			m_levels[i].display();
+		}
+
+		// Blur every level, then add it onto the next larger one, smallest first
+		for(int i = numLevels - 1; i >= 0; i--)
+		{
+			const float width = static_cast<float>(m_levels[i].getSize().x);
+			const float height = static_cast<float>(m_levels[i].getSize().y);
+
+			m_blurShader.setParameter("targetSize", width, height);
+
+			// Horizontal
+			BeginPass(m_blurLevels[i]);
+
+			m_blurShader.setParameter("source", m_levels[i].getTexture());
+			m_blurShader.setParameter("direction", 1.0f, 0.0f);
+
+			sf::Shader::bind(&m_blurShader);
+			RenderFullTarget(m_blurLevels[i]);
+			sf::Shader::bind(NULL);
+
+			m_blurLevels[i].display();
+
+			// Vertical
+			BeginPass(m_levels[i]);
+
+			m_blurShader.setParameter("source", m_blurLevels[i].getTexture());
+			m_blurShader.setParameter("direction", 0.0f, 1.0f);
+
+			sf::Shader::bind(&m_blurShader);
+			RenderFullTarget(m_levels[i]);
+
+			// Add the smaller level, which is already complete
+			if(i + 1 < numLevels)
+			{
+				m_copyShader.setParameter("source", m_levels[i + 1].getTexture());
+				m_copyShader.setParameter("targetSize", width, height);
+
+				glEnable(GL_BLEND);
+				glBlendFunc(GL_ONE, GL_ONE);
+
+				sf::Shader::bind(&m_copyShader);
+				RenderFullTarget(m_levels[i]);
+
+				glDisable(GL_BLEND);
+			}
+
+			sf::Shader::bind(NULL);
+
+			m_levels[i].display();
+		}
+
+		glEnable(GL_BLEND);
+	}
+
+	const sf::Texture &BloomPipeline::GetTexture() const
+	{
+		return m_levels[0].getTexture();
+	}
+}
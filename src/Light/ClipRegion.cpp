@@ -0,0 +1,139 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <LTBL/Light/ClipRegion.h>
+#include <LTBL/Utils.h>
+
+#include <cmath>
+
+namespace ltbl
+{
+	void ClipRegion::SetCircle(const Vec2f &center, float radius, int numSides)
+	{
+		// Push the vertices out, so that the edges touch the circle instead of cutting into it
+		float vertexRadius = radius / std::cos(pif / numSides);
+		float angleStep = pifTimes2 / numSides;
+
+		m_vertices.resize(numSides);
+
+		for(int i = 0; i < numSides; i++)
+		{
+			float angle = i * angleStep;
+			m_vertices[i] = Vec2f(center.x + vertexRadius * std::cos(angle), center.y + vertexRadius * std::sin(angle));
+		}
+	}
+
+	void ClipRegion::SetAABB(const AABB &aabb)
+	{
+		m_vertices.resize(4);
+
+		m_vertices[0] = aabb.m_lowerBound;
+		m_vertices[1] = Vec2f(aabb.m_upperBound.x, aabb.m_lowerBound.y);
+		m_vertices[2] = aabb.m_upperBound;
+		m_vertices[3] = Vec2f(aabb.m_lowerBound.x, aabb.m_upperBound.y);
+	}
+
+	void ClipRegion::Intersect(const AABB &aabb)
+	{
+		ClipRegion box;
+		box.SetAABB(aabb);
+
+		std::vector<Vec2f> noTexCoords;
+		box.ClipPolygon(m_vertices, noTexCoords);
+	}
+
+	bool ClipRegion::Empty() const
+	{
+		return m_vertices.size() < 3;
+	}
+
+	const std::vector<Vec2f> &ClipRegion::GetVertices() const
+	{
+		return m_vertices;
+	}
+
+	void ClipRegion::ClipPolygon(std::vector<Vec2f> &positions, std::vector<Vec2f> &texCoords) const
+	{
+		const unsigned int numEdges = m_vertices.size();
+
+		for(unsigned int i = 0; i < numEdges && !positions.empty(); i++)
+		{
+			ClipToLine(m_vertices[i], m_vertices[Wrap(i + 1, numEdges)], positions, texCoords, m_tempPositions, m_tempTexCoords);
+
+			positions.swap(m_tempPositions);
+			texCoords.swap(m_tempTexCoords);
+		}
+
+		if(positions.size() < 3)
+		{
+			positions.clear();
+			texCoords.clear();
+		}
+	}
+
+	void ClipRegion::ClipToLine(const Vec2f &start, const Vec2f &end, std::vector<Vec2f> &positions, std::vector<Vec2f> &texCoords,
+		std::vector<Vec2f> &resultPositions, std::vector<Vec2f> &resultTexCoords)
+	{
+		resultPositions.clear();
+		resultTexCoords.clear();
+
+		const unsigned int numVertices = positions.size();
+
+		if(numVertices == 0)
+			return;
+
+		const bool hasTexCoords = texCoords.size() == numVertices;
+
+		Vec2f lineDir(end - start);
+
+		// Sutherland-Hodgman against a single line
+		unsigned int prev = numVertices - 1;
+		float prevSide = lineDir.Cross(positions[prev] - start);
+
+		for(unsigned int i = 0; i < numVertices; i++)
+		{
+			float side = lineDir.Cross(positions[i] - start);
+
+			if((side >= 0.0f) != (prevSide >= 0.0f))
+			{
+				// Edge crosses the line, add the intersection
+				float t = prevSide / (prevSide - side);
+
+				resultPositions.push_back(positions[prev] + (positions[i] - positions[prev]) * t);
+
+				if(hasTexCoords)
+					resultTexCoords.push_back(texCoords[prev] + (texCoords[i] - texCoords[prev]) * t);
+			}
+
+			if(side >= 0.0f)
+			{
+				resultPositions.push_back(positions[i]);
+
+				if(hasTexCoords)
+					resultTexCoords.push_back(texCoords[i]);
+			}
+
+			prev = i;
+			prevSide = side;
+		}
+	}
+}
@@ -32,7 +32,8 @@ namespace ltbl
 	ConvexHull::ConvexHull()
 		: m_worldCenter(0.0f, 0.0f),
 		m_aabbCalculated(false),
-		m_updateRequired(true), // Remains true permanently unless user purposely changes it
+		m_generation(0),
+		m_lightGeneration(0),
 		m_transparency(1.0f),
 		m_renderLightOverHull(true)
 	{
@@ -163,6 +164,8 @@ namespace ltbl
 		m_aabb.CalculateCenter();
 
 		m_aabbCalculated = true;
+
+		m_generation++;
 	}
 
 	bool ConvexHull::HasCalculatedAABB() const
@@ -177,6 +180,8 @@ namespace ltbl
 		m_aabb.SetCenter(m_worldCenter);
 
 		TreeUpdate();
+
+		m_generation++;
 	}
 
 	void ConvexHull::IncWorldCenter(const Vec2f &increment)
@@ -186,6 +191,18 @@ namespace ltbl
 		m_aabb.IncCenter(increment);
 
 		TreeUpdate();
+
+		m_generation++;
+	}
+
+	void ConvexHull::Invalidate()
+	{
+		m_generation++;
+	}
+
+	unsigned int ConvexHull::GetGeneration() const
+	{
+		return m_generation;
 	}
 
 	Vec2f ConvexHull::GetWorldCenter() const
@@ -0,0 +1,566 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
+#include <LTBL/Light/DistanceField.h>
+#include <LTBL/Light/RenderTargetUtils.h>
+
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+namespace ltbl
+{
+	namespace
+	{
+		// Field pixel coordinates are stored with 16 bits each, 65535 means no hull
+		const std::string seedCodingSource =
+			"vec2 Decode(vec4 texel)\n"
+			"{\n"
+			"	vec4 bytes = floor(texel * 255.0 + 0.5);\n"
+			"	return vec2(bytes.r * 256.0 + bytes.g, bytes.b * 256.0 + bytes.a);\n"
+			"}\n"
+			"vec4 Encode(vec2 seed)\n"
+			"{\n"
+			"	vec2 high = floor(seed / 256.0);\n"
+			"	vec2 low = seed - high * 256.0;\n"
+			"	return vec4(high.x, low.x, high.y, low.y) / 255.0;\n"
+			"}\n";
+
+		// Index of the texture tile holding the world tile
+		int WrapTile(int tile, unsigned int numTiles)
+		{
+			const int slot = tile % static_cast<int>(numTiles);
+
+			return slot < 0 ? slot + static_cast<int>(numTiles) : slot;
+		}
+	}
+
+	DistanceField::DistanceField()
+		: m_viewSize(0.0f, 0.0f), m_scale(0.5f), m_pixelsPerUnit(0.0f), m_tileWorldSize(1.0f), m_fieldWidth(0), m_fieldHeight(0), m_seedIndex(0), m_shadersLoaded(false), m_available(false),
+		m_tileSize(64), m_numTilesX(0), m_numTilesY(0), m_originTileX(0), m_originTileY(0), m_anyTileDirty(true), m_frame(0)
+	{
+	}
+
+	void DistanceField::Create(bool useVertexBuffer, float scale)
+	{
+		for(int i = 0; i < num_lightTargets; i++)
+			m_quads[i].Create(useVertexBuffer);
+
+		m_scale = scale;
+
+		m_shadersLoaded = false;
+		m_available = false;
+
+		if(!sf::Shader::isAvailable())
+			return;
+
+		const std::string seedShaderSource =
+			"uniform sampler2D occupancy;\n"
+			"uniform vec2 fieldSize;\n"
+			"uniform vec2 wrapOffset;\n" +
+			seedCodingSource +
+			"void main()\n"
+			"{\n"
+			"	vec2 position = floor(gl_FragCoord.xy);\n"
+			"	vec2 texel = mod(position + wrapOffset, fieldSize);\n"
+			"	gl_FragColor = texture2D(occupancy, (texel + 0.5) / fieldSize).r > 0.5 ? Encode(position) : Encode(vec2(65535.0, 65535.0));\n"
+			"}\n";
+
+		// Every pixel takes the nearest of the seeds found by its neighbours at the current step distance
+		const std::string floodShaderSource =
+			"uniform sampler2D seeds;\n"
+			"uniform vec2 fieldSize;\n"
+			"uniform float stepSize;\n" +
+			seedCodingSource +
+			"void main()\n"
+			"{\n"
+			"	vec2 position = floor(gl_FragCoord.xy);\n"
+			"	vec2 best = vec2(65535.0, 65535.0);\n"
+			"	float bestDistance = 1.0e20;\n"
+			"	for(int y = -1; y <= 1; y++)\n"
+			"		for(int x = -1; x <= 1; x++)\n"
+			"		{\n"
+			"			vec2 neighbour = position + vec2(float(x), float(y)) * stepSize;\n"
+			"			if(neighbour.x < 0.0 || neighbour.y < 0.0 || neighbour.x >= fieldSize.x || neighbour.y >= fieldSize.y)\n"
+			"				continue;\n"
+			"			vec2 seed = Decode(texture2D(seeds, (neighbour + 0.5) / fieldSize));\n"
+			"			if(seed.x == 65535.0)\n"
+			"				continue;\n"
+			"			float distance = dot(seed - position, seed - position);\n"
+			"			if(distance < bestDistance)\n"
+			"			{\n"
+			"				bestDistance = distance;\n"
+			"				best = seed;\n"
+			"			}\n"
+			"		}\n"
+			"	gl_FragColor = Encode(best);\n"
+			"}\n";
+
+		// The march goes from the pixel towards the light, the cone from the pixel to the light disk (of the light size) gives the penumbra
+		const std::string lightFragmentShaderSource =
+			"uniform sampler2D seeds;\n"
+			"uniform sampler2D occupancy;\n"
+			"uniform vec2 fieldSize;\n"
+			"uniform float fieldScale;\n"
+			"uniform vec2 fieldOffset;\n"
+			"uniform vec2 wrapOffset;\n"
+			"varying vec3 light;\n"
+			"varying vec4 params;\n"
+			"varying vec2 range;\n"
+			"const float pi = 3.14159265;\n" +
+			seedCodingSource +
+			LightQuads::GetAttenuationSource() +
+			"float Distance(vec2 position)\n"
+			"{\n"
+			"	vec2 fieldPosition = position * fieldScale + fieldOffset;\n"
+			"	vec2 seed = Decode(texture2D(seeds, (floor(fieldPosition) + 0.5) / fieldSize));\n"
+			"	if(seed.x == 65535.0)\n"
+			"		return 100000.0;\n"
+			"	return length(seed + 0.5 - fieldPosition) / fieldScale;\n"
+			"}\n"
+			"void main()\n"
+			"{\n"
+			"	vec2 toLight = light.xy - gl_FragCoord.xy;\n"
+			"	float dist = length(toLight);\n"
+			"	if(mod(atan(-toLight.y, -toLight.x) - range.x, 2.0 * pi) > range.y)\n"
+			"		discard;\n"
+			"	float attenuation = Attenuation(dist, light.z, params.x, params.y);\n"
+			"	vec2 direction = toLight / max(dist, 0.0001);\n"
+			"	float texel = 1.0 / fieldScale;\n"
+			"	vec2 occupancyTexel = mod(floor(gl_FragCoord.xy * fieldScale + fieldOffset) + wrapOffset, fieldSize);\n"
+			"	bool overHull = texture2D(occupancy, (occupancyTexel + 0.5) / fieldSize).g > 0.5;\n"
+			"	float lit = attenuation > 0.0 ? 1.0 : 0.0;\n"
+			"	float t = 0.0;\n"
+			"	for(int i = 0; i < 48; i++)\n"
+			"	{\n"
+			"		if(t >= dist || lit <= 0.0)\n"
+			"			break;\n"
+			"		float distance = Distance(gl_FragCoord.xy + direction * t);\n"
+			"		if(overHull && distance < texel)\n"
+			"		{\n"
+			"			t += texel;\n"
+			"			continue;\n"
+			"		}\n"
+			"		overHull = false;\n"
+			"		lit = min(lit, clamp(distance / max(params.z * t / dist, 0.0001), 0.0, 1.0));\n"
+			"		t += max(distance, texel);\n"
+			"	}\n"
+			"	gl_FragColor = vec4(gl_Color.rgb * attenuation * lit, 1.0);\n"
+			"}\n";
+
+		if(!m_seedShader.loadFromMemory(seedShaderSource, sf::Shader::Fragment) ||
+			!m_floodShader.loadFromMemory(floodShaderSource, sf::Shader::Fragment) ||
+			!m_lightShader.loadFromMemory(LightQuads::GetVertexShaderSource(), lightFragmentShaderSource))
+			return;
+
+		m_seedShader.setParameter("occupancy", m_occupancyTexture.getTexture());
+		m_lightShader.setParameter("occupancy", m_occupancyTexture.getTexture());
+		m_lightShader.setParameter("fieldScale", m_scale);
+
+		m_shadersLoaded = true;
+	}
+
+	void DistanceField::SetViewSize(const Vec2f &viewSize)
+	{
+		m_viewSize = viewSize;
+
+		// The textures are sized by the next view
+		m_pixelsPerUnit = 0.0f;
+		m_fieldWidth = 0;
+		m_fieldHeight = 0;
+		m_numTilesX = 0;
+		m_numTilesY = 0;
+		m_tiles.clear();
+
+		m_hullStates.clear();
+
+		m_available = m_shadersLoaded;
+	}
+
+	bool DistanceField::Resize(unsigned int numTilesX, unsigned int numTilesY)
+	{
+		m_numTilesX = numTilesX;
+		m_numTilesY = numTilesY;
+
+		m_fieldWidth = m_numTilesX * m_tileSize;
+		m_fieldHeight = m_numTilesY * m_tileSize;
+
+		// No world tile starts at the lowest int, so every tile is redrawn
+		Tile emptyTile;
+		emptyTile.m_x = emptyTile.m_y = std::numeric_limits<int>::min();
+		emptyTile.m_dirty = true;
+
+		m_tiles.assign(m_numTilesX * m_numTilesY, emptyTile);
+		m_anyTileDirty = true;
+
+		if(!m_occupancyTexture.create(m_fieldWidth, m_fieldHeight, false) ||
+			!m_seedTextures[0].create(m_fieldWidth, m_fieldHeight, false) ||
+			!m_seedTextures[1].create(m_fieldWidth, m_fieldHeight, false))
+			return false;
+
+		m_seedShader.setParameter("fieldSize", static_cast<float>(m_fieldWidth), static_cast<float>(m_fieldHeight));
+		m_floodShader.setParameter("fieldSize", static_cast<float>(m_fieldWidth), static_cast<float>(m_fieldHeight));
+		m_lightShader.setParameter("fieldSize", static_cast<float>(m_fieldWidth), static_cast<float>(m_fieldHeight));
+
+		return true;
+	}
+
+	bool DistanceField::Available() const
+	{
+		return m_available;
+	}
+
+	void DistanceField::InvalidateRegion(const AABB &region)
+	{
+		int lowerX = std::max(static_cast<int>(std::floor(region.m_lowerBound.x / m_tileWorldSize)), m_originTileX);
+		int lowerY = std::max(static_cast<int>(std::floor(region.m_lowerBound.y / m_tileWorldSize)), m_originTileY);
+		int upperX = std::min(static_cast<int>(std::floor(region.m_upperBound.x / m_tileWorldSize)), m_originTileX + static_cast<int>(m_numTilesX) - 1);
+		int upperY = std::min(static_cast<int>(std::floor(region.m_upperBound.y / m_tileWorldSize)), m_originTileY + static_cast<int>(m_numTilesY) - 1);
+
+		for(int y = lowerY; y <= upperY; y++)
+			for(int x = lowerX; x <= upperX; x++)
+			{
+				m_tiles[WrapTile(x, m_numTilesX) + WrapTile(y, m_numTilesY) * m_numTilesX].m_dirty = true;
+				m_anyTileDirty = true;
+			}
+	}
+
+	void DistanceField::SetView(const AABB &viewAABB, float padding)
+	{
+		if(!m_available)
+			return;
+
+		const Vec2f viewDims(viewAABB.GetDims());
+
+		const float pixelsPerUnit = viewDims.x > 0.0f ? m_viewSize.x / viewDims.x : 1.0f;
+
+		// The tiles are laid out anew with the zoom
+		if(pixelsPerUnit != m_pixelsPerUnit)
+		{
+			m_pixelsPerUnit = pixelsPerUnit;
+			m_tileWorldSize = m_tileSize / (m_scale * m_pixelsPerUnit);
+
+			for(unsigned int i = 0, numTiles = m_tiles.size(); i < numTiles; i++)
+				m_tiles[i].m_dirty = true;
+
+			m_anyTileDirty = true;
+		}
+
+		const int lowerViewTileX = static_cast<int>(std::floor(viewAABB.m_lowerBound.x / m_tileWorldSize));
+		const int lowerViewTileY = static_cast<int>(std::floor(viewAABB.m_lowerBound.y / m_tileWorldSize));
+		const int numViewTilesX = static_cast<int>(std::floor(viewAABB.m_upperBound.x / m_tileWorldSize)) - lowerViewTileX + 1;
+		const int numViewTilesY = static_cast<int>(std::floor(viewAABB.m_upperBound.y / m_tileWorldSize)) - lowerViewTileY + 1;
+
+		// Padding beyond the maximum texture size is cut off
+		const int maxTiles = static_cast<int>(sf::Texture::getMaximumSize() / m_tileSize);
+
+		const int paddingTiles = static_cast<int>(std::ceil(std::max(padding, 0.0f) / m_tileWorldSize));
+		const int paddingTilesX = std::max(std::min(paddingTiles, (maxTiles - numViewTilesX) / 2), 0);
+		const int paddingTilesY = std::max(std::min(paddingTiles, (maxTiles - numViewTilesY) / 2), 0);
+
+		const unsigned int numTilesX = numViewTilesX + paddingTilesX * 2;
+		const unsigned int numTilesY = numViewTilesY + paddingTilesY * 2;
+
+		// Grows only, so a light that comes and goes does not recreate the textures every time
+		if(numTilesX > m_numTilesX || numTilesY > m_numTilesY)
+		{
+			if(!Resize(std::max(numTilesX, m_numTilesX), std::max(numTilesY, m_numTilesY)))
+			{
+				m_available = false;
+
+				return;
+			}
+		}
+
+		m_originTileX = lowerViewTileX - paddingTilesX;
+		m_originTileY = lowerViewTileY - paddingTilesY;
+
+		// Tiles that now hold another world tile came into the field
+		for(unsigned int y = 0; y < m_numTilesY; y++)
+			for(unsigned int x = 0; x < m_numTilesX; x++)
+			{
+				Tile &tile = m_tiles[x + y * m_numTilesX];
+
+				const int tileX = m_originTileX + WrapTile(static_cast<int>(x) - m_originTileX, m_numTilesX);
+				const int tileY = m_originTileY + WrapTile(static_cast<int>(y) - m_originTileY, m_numTilesY);
+
+				if(tile.m_x != tileX || tile.m_y != tileY)
+				{
+					tile.m_x = tileX;
+					tile.m_y = tileY;
+					tile.m_dirty = true;
+
+					m_anyTileDirty = true;
+				}
+			}
+
+		m_region = AABB(Vec2f(m_originTileX * m_tileWorldSize, m_originTileY * m_tileWorldSize),
+			Vec2f((m_originTileX + static_cast<int>(m_numTilesX)) * m_tileWorldSize, (m_originTileY + static_cast<int>(m_numTilesY)) * m_tileWorldSize));
+
+		// Render target pixels are relative to the view, field pixels to the origin tile
+		const Vec2f fieldOffset((viewAABB.m_lowerBound - m_region.m_lowerBound) * (m_pixelsPerUnit * m_scale));
+
+		const float wrapOffsetX = static_cast<float>(WrapTile(m_originTileX, m_numTilesX) * m_tileSize);
+		const float wrapOffsetY = static_cast<float>(WrapTile(m_originTileY, m_numTilesY) * m_tileSize);
+
+		m_seedShader.setParameter("wrapOffset", wrapOffsetX, wrapOffsetY);
+		m_lightShader.setParameter("wrapOffset", wrapOffsetX, wrapOffsetY);
+		m_lightShader.setParameter("fieldOffset", fieldOffset.x, fieldOffset.y);
+	}
+
+	const AABB &DistanceField::GetRegion() const
+	{
+		return m_region;
+	}
+
+	void DistanceField::Update(const std::vector<qdt::QuadTreeOccupant*> &hullsInRegion)
+	{
+		if(!m_available)
+			return;
+
+		m_frame++;
+
+		for(unsigned int i = 0, numHulls = hullsInRegion.size(); i < numHulls; i++)
+		{
+			ConvexHull* pHull = static_cast<ConvexHull*>(hullsInRegion[i]);
+
+			const AABB &hullAABB = pHull->GetAABB();
+
+			std::unordered_map<ConvexHull*, HullState>::iterator it = m_hullStates.find(pHull);
+
+			if(it == m_hullStates.end())
+			{
+				HullState state;
+				state.m_aabb = hullAABB;
+				state.m_generation = pHull->GetGeneration();
+				state.m_renderLightOverHull = pHull->m_renderLightOverHull;
+				state.m_frame = m_frame;
+
+				m_hullStates[pHull] = state;
+
+				InvalidateRegion(hullAABB);
+			}
+			else
+			{
+				HullState &state = it->second;
+
+				// Light over hull is drawn into the occupancy, vertex edits in place only show in the generation
+				if(!(state.m_aabb.m_lowerBound == hullAABB.m_lowerBound) || !(state.m_aabb.m_upperBound == hullAABB.m_upperBound) ||
+					state.m_generation != pHull->GetGeneration() || state.m_renderLightOverHull != pHull->m_renderLightOverHull)
+				{
+					InvalidateRegion(state.m_aabb);
+					InvalidateRegion(hullAABB);
+
+					state.m_aabb = hullAABB;
+					state.m_generation = pHull->GetGeneration();
+					state.m_renderLightOverHull = pHull->m_renderLightOverHull;
+				}
+
+				state.m_frame = m_frame;
+			}
+		}
+
+		// Hulls that left the field or were removed
+		for(std::unordered_map<ConvexHull*, HullState>::iterator it = m_hullStates.begin(); it != m_hullStates.end();)
+		{
+			if(it->second.m_frame != m_frame)
+			{
+				InvalidateRegion(it->second.m_aabb);
+
+				it = m_hullStates.erase(it);
+			}
+			else
+				it++;
+		}
+
+		if(!m_anyTileDirty)
+			return;
+
+		// Redraw the occupancy of the dirty tiles
+		m_occupancyTexture.setActive();
+
+		glViewport(0, 0, m_fieldWidth, m_fieldHeight);
+
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		glOrtho(0, m_fieldWidth, 0, m_fieldHeight, -100.0f, 100.0f);
+		glMatrixMode(GL_MODELVIEW);
+
+		glDisable(GL_TEXTURE_2D);
+		glDisable(GL_BLEND);
+		glEnable(GL_SCISSOR_TEST);
+
+		const float fieldPixelsPerUnit = m_tileSize / m_tileWorldSize;
+
+		for(unsigned int y = 0; y < m_numTilesY; y++)
+			for(unsigned int x = 0; x < m_numTilesX; x++)
+			{
+				Tile &tile = m_tiles[x + y * m_numTilesX];
+
+				if(!tile.m_dirty)
+					continue;
+
+				glScissor(x * m_tileSize, y * m_tileSize, m_tileSize, m_tileSize);
+
+				const Vec2f tileLowerBound(tile.m_x * m_tileWorldSize, tile.m_y * m_tileWorldSize);
+
+				AABB tileAABB(tileLowerBound, tileLowerBound + Vec2f(m_tileWorldSize, m_tileWorldSize));
+
+				// World tile onto its place in the texture
+				glLoadIdentity();
+				glTranslatef(static_cast<float>(x * m_tileSize), static_cast<float>(y * m_tileSize), 0.0f);
+				glScalef(fieldPixelsPerUnit, fieldPixelsPerUnit, 1.0f);
+				glTranslatef(-tileLowerBound.x, -tileLowerBound.y, 0.0f);
+
+				// Clear with quad, like the light textures
+				glColor4f(0.0f, 0.0f, 0.0f, 0.0f);
+
+				glBegin(GL_QUADS);
+					glVertex2f(tileAABB.m_lowerBound.x, tileAABB.m_lowerBound.y);
+					glVertex2f(tileAABB.m_upperBound.x, tileAABB.m_lowerBound.y);
+					glVertex2f(tileAABB.m_upperBound.x, tileAABB.m_upperBound.y);
+					glVertex2f(tileAABB.m_lowerBound.x, tileAABB.m_upperBound.y);
+				glEnd();
+
+				for(unsigned int i = 0, numHulls = hullsInRegion.size(); i < numHulls; i++)
+				{
+					ConvexHull* pHull = static_cast<ConvexHull*>(hullsInRegion[i]);
+
+					if(!pHull->GetAABB().Intersects(tileAABB))
+						continue;
+
+					glColor4f(1.0f, pHull->m_renderLightOverHull ? 1.0f : 0.0f, 0.0f, 1.0f);
+
+					glBegin(GL_TRIANGLE_FAN);
+
+					for(unsigned int v = 0, numVertices = pHull->m_vertices.size(); v < numVertices; v++)
+					{
+						Vec2f vPos(pHull->GetWorldVertex(v));
+						glVertex2f(vPos.x, vPos.y);
+					}
+
+					glEnd();
+				}
+
+				tile.m_dirty = false;
+			}
+
+		glDisable(GL_SCISSOR_TEST);
+
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+		m_occupancyTexture.display();
+
+		m_anyTileDirty = false;
+
+		Flood();
+	}
+
+	void DistanceField::Flood()
+	{
+		const unsigned int maxStep = std::max(m_fieldWidth, m_fieldHeight) / 2;
+
+		// Seeds from the occupancy, then steps halving down to a single pixel
+		for(int pass = -1; ; pass++)
+		{
+			const unsigned int stepSize = pass < 0 ? 0 : maxStep >> pass;
+
+			if(pass >= 0 && stepSize == 0)
+				break;
+
+			sf::RenderTexture &target = m_seedTextures[pass < 0 ? 0 : 1 - m_seedIndex];
+
+			target.setActive();
+
+			glViewport(0, 0, m_fieldWidth, m_fieldHeight);
+
+			glMatrixMode(GL_PROJECTION);
+			glLoadIdentity();
+			glOrtho(0, m_fieldWidth, 0, m_fieldHeight, -100.0f, 100.0f);
+			glMatrixMode(GL_MODELVIEW);
+			glLoadIdentity();
+
+			glDisable(GL_BLEND);
+
+			if(pass < 0)
+			{
+				sf::Shader::bind(&m_seedShader);
+
+				RenderFullTarget(target);
+
+				m_seedIndex = 0;
+			}
+			else
+			{
+				m_floodShader.setParameter("seeds", m_seedTextures[m_seedIndex].getTexture());
+				m_floodShader.setParameter("stepSize", static_cast<float>(stepSize));
+
+				sf::Shader::bind(&m_floodShader);
+
+				RenderFullTarget(target);
+
+				m_seedIndex = 1 - m_seedIndex;
+			}
+
+			sf::Shader::bind(NULL);
+
+			target.display();
+		}
+	}
+
+	void DistanceField::Clear()
+	{
+		for(int i = 0; i < num_lightTargets; i++)
+			m_quads[i].Clear();
+	}
+
+	bool DistanceField::Empty(LightTarget target) const
+	{
+		return m_quads[target].Empty();
+	}
+
+	void DistanceField::AddLight(const Vec2f &center, float radius, float size, const Color3f &color, const Color3f &bloomColor, float bleed, float linearizeFactor,
+		float lowerAngle, float upperAngle, const Vec2f &pixelOffset, float pixelScale)
+	{
+		m_quads[target_composition].AddLight(center, radius, size, color, bleed, linearizeFactor, lowerAngle, upperAngle, 0.0f, pixelOffset, pixelScale);
+
+		if(bloomColor.r > 0.0f || bloomColor.g > 0.0f || bloomColor.b > 0.0f)
+			m_quads[target_bloom].AddLight(center, radius, size, bloomColor, bleed, linearizeFactor, lowerAngle, upperAngle, 0.0f, pixelOffset, pixelScale);
+	}
+
+	void DistanceField::Render(LightTarget target)
+	{
+		if(m_quads[target].Empty())
+			return;
+
+		m_lightShader.setParameter("seeds", m_seedTextures[m_seedIndex].getTexture());
+
+		m_quads[target].Render(m_lightShader);
+		m_quads[target].Clear();
+	}
+}
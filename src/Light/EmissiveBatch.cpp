@@ -0,0 +1,309 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
+#include <LTBL/Light/EmissiveBatch.h>
+#include <LTBL/Utils.h>
+
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace ltbl
+{
+	namespace
+	{
+		const unsigned int atlasSize = 2048;
+
+		// Empty texels around every region, so filtering does not pick up the neighbours
+		const unsigned int atlasPadding = 1;
+	}
+
+	EmissiveBatch::EmissiveBatch()
+		: m_atlasCreated(false), m_shelfX(0), m_shelfY(0), m_shelfHeight(0)
+	{
+	}
+
+	void EmissiveBatch::Create(bool useVertexBuffer)
+	{
+		m_stream.Create(useVertexBuffer);
+
+		const unsigned int size = std::min(atlasSize, sf::Texture::getMaximumSize());
+
+		m_atlasCreated = m_atlas.create(size, size, false);
+		m_atlas.setSmooth(true);
+
+		ClearAtlas();
+	}
+
+	void EmissiveBatch::Clear()
+	{
+		for(int i = 0; i < num_lightTargets; i++)
+			m_emissiveLights[i].clear();
+	}
+
+	bool EmissiveBatch::Empty(LightTarget target) const
+	{
+		return m_emissiveLights[target].empty();
+	}
+
+	void EmissiveBatch::AddEmissive(EmissiveLight* pEmissive, LightTarget target)
+	{
+		m_emissiveLights[target].push_back(pEmissive);
+	}
+
+	void EmissiveBatch::ClearAtlas()
+	{
+		m_atlasRegions.clear();
+
+		m_shelfX = atlasPadding;
+		m_shelfY = atlasPadding;
+		m_shelfHeight = 0;
+
+		if(m_atlasCreated)
+		{
+			m_atlas.setActive();
+			m_atlas.clear(sf::Color::Transparent);
+			m_atlas.display();
+		}
+	}
+
+	bool EmissiveBatch::AddToAtlas(const sf::Texture* pTexture, AtlasRegion &region)
+	{
+		if(!m_atlasCreated)
+			return false;
+
+		const sf::Vector2u atlasDims(m_atlas.getSize());
+		const sf::Vector2u textureDims(pTexture->getSize());
+
+		// Next shelf
+		if(m_shelfX + textureDims.x + atlasPadding > atlasDims.x)
+		{
+			m_shelfX = atlasPadding;
+			m_shelfY += m_shelfHeight + atlasPadding;
+			m_shelfHeight = 0;
+		}
+
+		if(m_shelfX + textureDims.x + atlasPadding > atlasDims.x || m_shelfY + textureDims.y + atlasPadding > atlasDims.y)
+			return false;
+
+		const float lowerX = static_cast<float>(m_shelfX);
+		const float lowerY = static_cast<float>(m_shelfY);
+		const float upperX = lowerX + textureDims.x;
+		const float upperY = lowerY + textureDims.y;
+
+		// Copy the texture with its alpha
+		sf::Texture::bind(NULL);
+		sf::Texture::bind(pTexture);
+
+		glBegin(GL_QUADS);
+			glTexCoord2i(0, 0); glVertex2f(lowerX, lowerY);
+			glTexCoord2i(1, 0); glVertex2f(upperX, lowerY);
+			glTexCoord2i(1, 1); glVertex2f(upperX, upperY);
+			glTexCoord2i(0, 1); glVertex2f(lowerX, upperY);
+		glEnd();
+
+		region.m_lowerU = lowerX / atlasDims.x;
+		region.m_lowerV = lowerY / atlasDims.y;
+		region.m_upperU = upperX / atlasDims.x;
+		region.m_upperV = upperY / atlasDims.y;
+
+		m_shelfX += textureDims.x + atlasPadding;
+		m_shelfHeight = std::max(m_shelfHeight, textureDims.y);
+
+		return true;
+	}
+
+	void EmissiveBatch::PackTextures()
+	{
+		bool atlasActive = false;
+
+		for(int t = 0; t < num_lightTargets; t++)
+			for(unsigned int i = 0, numEmissives = m_emissiveLights[t].size(); i < numEmissives; i++)
+			{
+				const sf::Texture* pTexture = m_emissiveLights[t][i]->m_texture;
+
+				if(m_atlasRegions.find(pTexture) != m_atlasRegions.end())
+					continue;
+
+				if(!atlasActive && m_atlasCreated)
+				{
+					m_atlas.setActive();
+
+					sf::Vector2u atlasDims(m_atlas.getSize());
+
+					glViewport(0, 0, atlasDims.x, atlasDims.y);
+
+					glMatrixMode(GL_PROJECTION);
+					glLoadIdentity();
+					glOrtho(0, atlasDims.x, 0, atlasDims.y, -100.0f, 100.0f);
+					glMatrixMode(GL_MODELVIEW);
+					glLoadIdentity();
+
+					glDisable(GL_BLEND);
+					glEnable(GL_TEXTURE_2D);
+					glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+					atlasActive = true;
+				}
+
+				AtlasRegion region;
+				region.m_inAtlas = AddToAtlas(pTexture, region);
+
+				m_atlasRegions[pTexture] = region;
+			}
+
+		if(atlasActive)
+		{
+			glEnable(GL_BLEND);
+
+			sf::Texture::bind(NULL);
+
+			m_atlas.display();
+		}
+	}
+
+	void EmissiveBatch::Render(LightTarget target)
+	{
+		std::vector<EmissiveLight*> &emissiveLights = m_emissiveLights[target];
+
+		if(emissiveLights.empty())
+			return;
+
+		m_vertices.clear();
+		m_looseQuads.clear();
+
+		for(unsigned int i = 0, numEmissives = emissiveLights.size(); i < numEmissives; i++)
+		{
+			EmissiveLight* pEmissive = emissiveLights[i];
+
+			const Vec2f &center = pEmissive->m_aabb.GetCenter();
+			const Vec2f &halfDims = pEmissive->m_halfRenderDims;
+
+			const float angleRads = pEmissive->m_angleDegs * (static_cast<float>(PI) / 180.0f);
+			const float cosAngle = std::cos(angleRads);
+			const float sinAngle = std::sin(angleRads);
+
+			// Same as the clamp in EmissiveLight::Render
+			const float alpha = std::min(pEmissive->m_intensity, 1.0f);
+
+			Quad quad;
+			quad.m_pTexture = pEmissive->m_texture;
+
+			AtlasRegion region;
+			std::unordered_map<const sf::Texture*, AtlasRegion>::iterator it = m_atlasRegions.find(quad.m_pTexture);
+
+			if(it != m_atlasRegions.end() && it->second.m_inAtlas)
+				region = it->second;
+			else
+			{
+				region.m_inAtlas = false;
+				region.m_lowerU = 0.0f; region.m_lowerV = 0.0f;
+				region.m_upperU = 1.0f; region.m_upperV = 1.0f;
+			}
+
+			const float cornerX[4] = { -halfDims.x, halfDims.x, halfDims.x, -halfDims.x };
+			const float cornerY[4] = { -halfDims.y, -halfDims.y, halfDims.y, halfDims.y };
+			const float cornerU[4] = { region.m_lowerU, region.m_upperU, region.m_upperU, region.m_lowerU };
+			const float cornerV[4] = { region.m_lowerV, region.m_lowerV, region.m_upperV, region.m_upperV };
+
+			// Rotate on the CPU, so no matrix changes are needed between emissives
+			for(int c = 0; c < 4; c++)
+			{
+				Vertex &vertex = quad.m_vertices[c];
+
+				vertex.m_x = center.x + cornerX[c] * cosAngle - cornerY[c] * sinAngle;
+				vertex.m_y = center.y + cornerX[c] * sinAngle + cornerY[c] * cosAngle;
+				vertex.m_u = cornerU[c];
+				vertex.m_v = cornerV[c];
+				vertex.m_r = pEmissive->m_color.r;
+				vertex.m_g = pEmissive->m_color.g;
+				vertex.m_b = pEmissive->m_color.b;
+				vertex.m_a = alpha;
+			}
+
+			if(region.m_inAtlas)
+				m_vertices.insert(m_vertices.end(), quad.m_vertices, quad.m_vertices + 4);
+			else
+				m_looseQuads.push_back(quad);
+		}
+
+		const unsigned int numAtlasVertices = m_vertices.size();
+
+		// Loose quads go after the atlas quads, grouped by texture
+		std::sort(m_looseQuads.begin(), m_looseQuads.end());
+
+		for(unsigned int i = 0, numQuads = m_looseQuads.size(); i < numQuads; i++)
+			m_vertices.insert(m_vertices.end(), m_looseQuads[i].m_vertices, m_looseQuads[i].m_vertices + 4);
+
+		const char* pVertices = m_stream.Upload(&m_vertices[0], m_vertices.size() * sizeof(Vertex));
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+
+		glClientActiveTexture(GL_TEXTURE0);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_x));
+		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_u));
+		glColorPointer(4, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_r));
+
+		if(numAtlasVertices != 0)
+		{
+			// The atlas is addressed in GL texture coordinates, so bind it without the flip SFML applies to render textures
+			sf::Texture::bind(NULL);
+			glBindTexture(GL_TEXTURE_2D, m_atlas.getTexture().getNativeHandle());
+
+			glDrawArrays(GL_QUADS, 0, numAtlasVertices);
+		}
+
+		for(unsigned int i = 0, numQuads = m_looseQuads.size(); i < numQuads;)
+		{
+			unsigned int end = i + 1;
+
+			while(end < numQuads && m_looseQuads[end].m_pTexture == m_looseQuads[i].m_pTexture)
+				end++;
+
+			sf::Texture::bind(NULL);
+			sf::Texture::bind(m_looseQuads[i].m_pTexture);
+
+			glDrawArrays(GL_QUADS, numAtlasVertices + i * 4, (end - i) * 4);
+
+			i = end;
+		}
+
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glDisableClientState(GL_COLOR_ARRAY);
+
+		m_stream.Unbind();
+
+		sf::Texture::bind(NULL);
+
+		// Color arrays leave the current color undefined
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+}
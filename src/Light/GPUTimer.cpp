@@ -0,0 +1,134 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
+#include <LTBL/Light/GPUTimer.h>
+
+namespace ltbl
+{
+	GPUTimer::GPUTimer()
+		: m_current(0), m_skipped(false), m_available(false), m_time(0.0f)
+	{
+		for(int i = 0; i < s_numQueries; i++)
+		{
+			m_startQueries[i] = 0;
+			m_endQueries[i] = 0;
+			m_pending[i] = false;
+		}
+	}
+
+	GPUTimer::~GPUTimer()
+	{
+		if(m_available)
+		{
+			glDeleteQueries(s_numQueries, m_startQueries);
+			glDeleteQueries(s_numQueries, m_endQueries);
+		}
+	}
+
+	void GPUTimer::Create()
+	{
+		// The old queries were deleted along with their context
+		m_available = false;
+		m_current = 0;
+		m_skipped = false;
+
+		for(int i = 0; i < s_numQueries; i++)
+			m_pending[i] = false;
+
+		if(!GLEW_ARB_timer_query)
+			return;
+
+		glGenQueries(s_numQueries, m_startQueries);
+		glGenQueries(s_numQueries, m_endQueries);
+
+		m_available = true;
+	}
+
+	bool GPUTimer::Available() const
+	{
+		return m_available;
+	}
+
+	void GPUTimer::CollectResults()
+	{
+		// Oldest first, so the latest finished measurement is kept
+		for(int i = 0; i < s_numQueries; i++)
+		{
+			const int index = (m_current + i) % s_numQueries;
+
+			if(!m_pending[index])
+				continue;
+
+			GLint available = 0;
+			glGetQueryObjectiv(m_endQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+
+			if(available == 0)
+				continue;
+
+			GLuint64 startTime = 0;
+			GLuint64 endTime = 0;
+
+			glGetQueryObjectui64v(m_startQueries[index], GL_QUERY_RESULT, &startTime);
+			glGetQueryObjectui64v(m_endQueries[index], GL_QUERY_RESULT, &endTime);
+
+			// Nanoseconds
+			m_time = static_cast<float>(endTime - startTime) / 1000000.0f;
+
+			m_pending[index] = false;
+		}
+	}
+
+	void GPUTimer::Begin()
+	{
+		if(!m_available)
+			return;
+
+		CollectResults();
+
+		m_skipped = m_pending[m_current];
+
+		if(m_skipped)
+			return;
+
+		glQueryCounter(m_startQueries[m_current], GL_TIMESTAMP);
+	}
+
+	void GPUTimer::End()
+	{
+		if(!m_available || m_skipped)
+			return;
+
+		glQueryCounter(m_endQueries[m_current], GL_TIMESTAMP);
+
+		m_pending[m_current] = true;
+
+		m_current = (m_current + 1) % s_numQueries;
+	}
+
+	float GPUTimer::GetTime() const
+	{
+		return m_time;
+	}
+}
@@ -0,0 +1,398 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
+#include <LTBL/Light/HullEdgeBuffer.h>
+#include <LTBL/Utils.h>
+
+#include <SFML/OpenGL.hpp>
+
+#include <cstddef>
+#include <string>
+
+namespace ltbl
+{
+	namespace
+	{
+		// Same back facing test as the visibility polygon, for a point light
+		const std::string facingSource =
+			"uniform vec2 lightCenter;\n"
+			"uniform float lightRadius;\n"
+			"uniform float lightSize;\n"
+			"bool BackFacing(vec2 start, vec2 end, vec2 hullCenter)\n"
+			"{\n"
+			"	vec2 edge = end - start;\n"
+			"	return (edge.x * (hullCenter.y - start.y) - edge.y * (hullCenter.x - start.x) >= 0.0) == (edge.x * (lightCenter.y - start.y) - edge.y * (lightCenter.x - start.x) >= 0.0);\n"
+			"}\n"
+			"vec2 LightNormal(vec2 vertex, vec2 hullCenter)\n"
+			"{\n"
+			"	vec2 fromLight = vertex - lightCenter;\n"
+			"	vec2 normal = normalize(vec2(-fromLight.y, fromLight.x));\n"
+			"	return dot(normal, vertex - hullCenter) < 0.0 ? -normal : normal;\n"
+			"}\n";
+
+		void SetVertex(float* pAttributes, const Vec2f &first, const Vec2f &second, const Vec2f &third, const Vec2f &fourth, float a, float b, float c, float d)
+		{
+			pAttributes[0] = first.x; pAttributes[1] = first.y; pAttributes[2] = second.x; pAttributes[3] = second.y;
+			pAttributes[4] = third.x; pAttributes[5] = third.y; pAttributes[6] = fourth.x; pAttributes[7] = fourth.y;
+			pAttributes[8] = a; pAttributes[9] = b; pAttributes[10] = c; pAttributes[11] = d;
+		}
+	}
+
+	HullEdgeBuffer::HullEdgeBuffer()
+		: m_umbraBuffer(0), m_finBuffer(0), m_available(false), m_rebuildRequired(true)
+	{
+	}
+
+	HullEdgeBuffer::~HullEdgeBuffer()
+	{
+		if(m_umbraBuffer != 0)
+			glDeleteBuffers(1, &m_umbraBuffer);
+
+		if(m_finBuffer != 0)
+			glDeleteBuffers(1, &m_finBuffer);
+	}
+
+	void HullEdgeBuffer::Create(bool useVertexBuffer)
+	{
+		if(useVertexBuffer && m_umbraBuffer == 0)
+		{
+			glGenBuffers(1, &m_umbraBuffer);
+			glGenBuffers(1, &m_finBuffer);
+		}
+
+		m_available = false;
+
+		if(!sf::Shader::isAvailable())
+			return;
+
+		// Edges that shadow the light are pushed away from it, the others collapse.
+		// At silhouette vertices the ray starts from the edge of the light, like the main umbra in MaskShadow
+		const std::string umbraVertexShaderSource = facingSource +
+			"void main()\n"
+			"{\n"
+			"	vec2 vertex = gl_MultiTexCoord0.xy;\n"
+			"	vec2 other = gl_MultiTexCoord0.zw;\n"
+			"	vec2 neighbour = gl_MultiTexCoord1.xy;\n"
+			"	vec2 hullCenter = gl_MultiTexCoord1.zw;\n"
+			"	bool isEnd = gl_MultiTexCoord2.w > 0.5;\n"
+			"	bool backFacing = isEnd ? BackFacing(other, vertex, hullCenter) : BackFacing(vertex, other, hullCenter);\n"
+			"	bool extrude = gl_MultiTexCoord2.z > 0.5 ? backFacing : !backFacing;\n"
+			"	vec2 position = vertex;\n"
+			"	if(extrude && gl_MultiTexCoord2.x > 0.5)\n"
+			"	{\n"
+			"		bool neighbourBackFacing = isEnd ? BackFacing(vertex, neighbour, hullCenter) : BackFacing(neighbour, vertex, hullCenter);\n"
+			"		vec2 offset = neighbourBackFacing != backFacing ? LightNormal(vertex, hullCenter) * lightSize : vec2(0.0, 0.0);\n"
+			"		position = vertex + normalize(vertex - (lightCenter + offset)) * lightRadius;\n"
+			"	}\n"
+			"	gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);\n"
+			"	gl_FrontColor = vec4(0.0, 0.0, 0.0, 1.0 - gl_MultiTexCoord2.y);\n"
+			"}\n";
+
+		const std::string umbraFragmentShaderSource =
+			"void main()\n"
+			"{\n"
+			"	gl_FragColor = gl_Color;\n"
+			"}\n";
+
+		// Fins only exist at silhouette vertices, same texture coordinates as ShadowFin
+		const std::string finVertexShaderSource = facingSource +
+			"void main()\n"
+			"{\n"
+			"	vec2 vertex = gl_MultiTexCoord0.xy;\n"
+			"	vec2 previous = gl_MultiTexCoord0.zw;\n"
+			"	vec2 next = gl_MultiTexCoord1.xy;\n"
+			"	vec2 hullCenter = gl_MultiTexCoord1.zw;\n"
+			"	float corner = gl_MultiTexCoord2.x;\n"
+			"	vec2 position = vertex;\n"
+			"	vec2 texCoord = vec2(0.0, 1.0);\n"
+			"	if(BackFacing(previous, vertex, hullCenter) != BackFacing(vertex, next, hullCenter) && corner > 0.5)\n"
+			"	{\n"
+			"		vec2 normal = LightNormal(vertex, hullCenter) * lightSize;\n"
+			"		if(corner < 1.5)\n"
+			"		{\n"
+			"			position = vertex + normalize(vertex - (lightCenter - normal)) * lightRadius;\n"
+			"			texCoord = vec2(0.0, 0.0);\n"
+			"		}\n"
+			"		else\n"
+			"		{\n"
+			"			position = vertex + normalize(vertex - (lightCenter + normal)) * lightRadius;\n"
+			"			texCoord = vec2(1.0, 0.0);\n"
+			"		}\n"
+			"	}\n"
+			"	gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);\n"
+			"	gl_TexCoord[0] = vec4(texCoord, 0.0, 1.0);\n"
+			"	gl_FrontColor = vec4(1.0, 1.0, 1.0, gl_MultiTexCoord2.y);\n"
+			"}\n";
+
+		const std::string finFragmentShaderSource =
+			"uniform sampler2D finTexture;\n"
+			"void main()\n"
+			"{\n"
+			"	gl_FragColor = vec4(0.0, 0.0, 0.0, gl_Color.a * texture2D(finTexture, gl_TexCoord[0].xy).a);\n"
+			"}\n";
+
+		if(!m_umbraShader.loadFromMemory(umbraVertexShaderSource, umbraFragmentShaderSource) ||
+			!m_finShader.loadFromMemory(finVertexShaderSource, finFragmentShaderSource))
+			return;
+
+		m_available = true;
+	}
+
+	bool HullEdgeBuffer::Available() const
+	{
+		return m_available;
+	}
+
+	void HullEdgeBuffer::Invalidate()
+	{
+		m_rebuildRequired = true;
+	}
+
+	void HullEdgeBuffer::WriteHull(ConvexHull* pHull, HullSlot &slot)
+	{
+		const unsigned int numVertices = pHull->m_vertices.size();
+
+		const Vec2f hullCenter(pHull->GetWorldCenter());
+		const float lightOverHull = pHull->m_renderLightOverHull ? 1.0f : 0.0f;
+
+		slot.m_worldCenter = hullCenter;
+		slot.m_transparency = pHull->m_transparency;
+		slot.m_renderLightOverHull = pHull->m_renderLightOverHull;
+		slot.m_generation = pHull->GetGeneration();
+
+		for(unsigned int i = 0; i < numVertices; i++)
+		{
+			const Vec2f previous(pHull->GetWorldVertex(Wrap(i + numVertices - 1, numVertices)));
+			const Vec2f start(pHull->GetWorldVertex(i));
+			const Vec2f end(pHull->GetWorldVertex(Wrap(i + 1, numVertices)));
+			const Vec2f next(pHull->GetWorldVertex(Wrap(i + 2, numVertices)));
+
+			// Quad of the edge from start to end
+			Vertex* pUmbra = &m_umbraVertices[slot.m_umbraFirst + i * 4];
+
+			SetVertex(pUmbra[0].m_attributes, start, end, previous, hullCenter, 0.0f, slot.m_transparency, lightOverHull, 0.0f);
+			SetVertex(pUmbra[1].m_attributes, end, start, next, hullCenter, 0.0f, slot.m_transparency, lightOverHull, 1.0f);
+			SetVertex(pUmbra[2].m_attributes, end, start, next, hullCenter, 1.0f, slot.m_transparency, lightOverHull, 1.0f);
+			SetVertex(pUmbra[3].m_attributes, start, end, previous, hullCenter, 1.0f, slot.m_transparency, lightOverHull, 0.0f);
+
+			// Fin of the start vertex
+			Vertex* pFin = &m_finVertices[slot.m_finFirst + i * 3];
+
+			for(int c = 0; c < 3; c++)
+				SetVertex(pFin[c].m_attributes, start, previous, end, hullCenter, static_cast<float>(c), slot.m_transparency, 0.0f, 0.0f);
+		}
+	}
+
+	void HullEdgeBuffer::Rebuild(const std::unordered_set<ConvexHull*> &hulls)
+	{
+		m_slots.clear();
+
+		unsigned int numUmbraVertices = 0;
+		unsigned int numFinVertices = 0;
+
+		for(std::unordered_set<ConvexHull*>::const_iterator it = hulls.begin(); it != hulls.end(); it++)
+		{
+			HullSlot slot;
+			slot.m_umbraFirst = numUmbraVertices;
+			slot.m_finFirst = numFinVertices;
+			slot.m_numVertices = (*it)->m_vertices.size();
+
+			numUmbraVertices += slot.m_numVertices * 4;
+			numFinVertices += slot.m_numVertices * 3;
+
+			m_slots[*it] = slot;
+		}
+
+		m_umbraVertices.resize(numUmbraVertices);
+		m_finVertices.resize(numFinVertices);
+
+		for(std::unordered_map<ConvexHull*, HullSlot>::iterator it = m_slots.begin(); it != m_slots.end(); it++)
+			WriteHull(it->first, it->second);
+
+		if(m_umbraBuffer != 0 && !m_umbraVertices.empty())
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_umbraBuffer);
+			glBufferData(GL_ARRAY_BUFFER, m_umbraVertices.size() * sizeof(Vertex), &m_umbraVertices[0], GL_DYNAMIC_DRAW);
+
+			glBindBuffer(GL_ARRAY_BUFFER, m_finBuffer);
+			glBufferData(GL_ARRAY_BUFFER, m_finVertices.size() * sizeof(Vertex), &m_finVertices[0], GL_DYNAMIC_DRAW);
+
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		m_rebuildRequired = false;
+	}
+
+	void HullEdgeBuffer::Update(const std::unordered_set<ConvexHull*> &hulls)
+	{
+		if(!m_available)
+			return;
+
+		if(m_rebuildRequired || hulls.size() != m_slots.size())
+		{
+			Rebuild(hulls);
+
+			return;
+		}
+
+		for(std::unordered_set<ConvexHull*>::const_iterator it = hulls.begin(); it != hulls.end(); it++)
+		{
+			ConvexHull* pHull = *it;
+
+			std::unordered_map<ConvexHull*, HullSlot>::iterator slotIt = m_slots.find(pHull);
+
+			// Vertex count changes move all following hulls
+			if(slotIt == m_slots.end() || slotIt->second.m_numVertices != pHull->m_vertices.size())
+			{
+				Rebuild(hulls);
+
+				return;
+			}
+
+			HullSlot &slot = slotIt->second;
+
+			if(slot.m_worldCenter == pHull->GetWorldCenter() && slot.m_transparency == pHull->m_transparency && slot.m_renderLightOverHull == pHull->m_renderLightOverHull &&
+				slot.m_generation == pHull->GetGeneration())
+				continue;
+
+			WriteHull(pHull, slot);
+
+			if(m_umbraBuffer != 0)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, m_umbraBuffer);
+				glBufferSubData(GL_ARRAY_BUFFER, slot.m_umbraFirst * sizeof(Vertex), slot.m_numVertices * 4 * sizeof(Vertex), &m_umbraVertices[slot.m_umbraFirst]);
+
+				glBindBuffer(GL_ARRAY_BUFFER, m_finBuffer);
+				glBufferSubData(GL_ARRAY_BUFFER, slot.m_finFirst * sizeof(Vertex), slot.m_numVertices * 3 * sizeof(Vertex), &m_finVertices[slot.m_finFirst]);
+
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+			}
+		}
+	}
+
+	void HullEdgeBuffer::SetUpArrays(const std::vector<Vertex> &vertices, unsigned int buffer)
+	{
+		const char* pVertices;
+
+		if(buffer != 0)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+			pVertices = NULL;
+		}
+		else
+			pVertices = reinterpret_cast<const char*>(&vertices[0]);
+
+		// The shaders only read the attributes, the position comes from them
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), pVertices);
+
+		for(int i = 0; i < 3; i++)
+		{
+			glClientActiveTexture(GL_TEXTURE0 + i);
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glTexCoordPointer(4, GL_FLOAT, sizeof(Vertex), pVertices + i * 4 * sizeof(float));
+		}
+	}
+
+	void HullEdgeBuffer::ResetArrays(unsigned int buffer)
+	{
+		for(int i = 2; i >= 0; i--)
+		{
+			glClientActiveTexture(GL_TEXTURE0 + i);
+			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		}
+
+		glDisableClientState(GL_VERTEX_ARRAY);
+
+		if(buffer != 0)
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void HullEdgeBuffer::Render(const Vec2f &lightCenter, float lightRadius, float lightSize, const std::vector<ConvexHull*> &hulls, const sf::Texture &finTexture)
+	{
+		m_umbraFirsts.clear();
+		m_umbraCounts.clear();
+		m_finFirsts.clear();
+		m_finCounts.clear();
+
+		for(unsigned int h = 0, numHulls = hulls.size(); h < numHulls; h++)
+		{
+			std::unordered_map<ConvexHull*, HullSlot>::const_iterator it = m_slots.find(hulls[h]);
+
+			if(it == m_slots.end())
+				continue;
+
+			const HullSlot &slot = it->second;
+
+			m_umbraFirsts.push_back(slot.m_umbraFirst);
+			m_umbraCounts.push_back(slot.m_numVertices * 4);
+			m_finFirsts.push_back(slot.m_finFirst);
+			m_finCounts.push_back(slot.m_numVertices * 3);
+		}
+
+		if(m_umbraFirsts.empty())
+			return;
+
+		// Umbras
+		glDisable(GL_TEXTURE_2D);
+
+		glBlendFunc(GL_ZERO, GL_SRC_ALPHA);
+
+		m_umbraShader.setParameter("lightCenter", lightCenter.x, lightCenter.y);
+		m_umbraShader.setParameter("lightRadius", lightRadius);
+		m_umbraShader.setParameter("lightSize", lightSize);
+
+		sf::Shader::bind(&m_umbraShader);
+
+		SetUpArrays(m_umbraVertices, m_umbraBuffer);
+
+		glMultiDrawArrays(GL_QUADS, &m_umbraFirsts[0], &m_umbraCounts[0], m_umbraFirsts.size());
+
+		ResetArrays(m_umbraBuffer);
+
+		// Fins
+		glEnable(GL_TEXTURE_2D);
+
+		glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+
+		m_finShader.setParameter("lightCenter", lightCenter.x, lightCenter.y);
+		m_finShader.setParameter("lightRadius", lightRadius);
+		m_finShader.setParameter("lightSize", lightSize);
+		m_finShader.setParameter("finTexture", finTexture);
+
+		sf::Shader::bind(&m_finShader);
+
+		SetUpArrays(m_finVertices, m_finBuffer);
+
+		glMultiDrawArrays(GL_TRIANGLES, &m_finFirsts[0], &m_finCounts[0], m_finFirsts.size());
+
+		ResetArrays(m_finBuffer);
+
+		sf::Shader::bind(NULL);
+
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+}
@@ -0,0 +1,331 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <LTBL/Light/HullTileMap.h>
+#include <LTBL/Light/LightSystem.h>
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <tuple>
+
+namespace ltbl
+{
+	HullTileMap::HullTileMap()
+		: m_pLightSystem(NULL), m_width(0), m_height(0),
+		m_chunkSize(16), m_numChunksX(0), m_numChunksY(0)
+	{
+	}
+
+	HullTileMap::HullTileMap(LightSystem* pLightSystem, int width, int height, const Vec2f &tileDims, const Vec2f &origin, int chunkSize)
+		: m_pLightSystem(NULL), m_width(0), m_height(0),
+		m_chunkSize(16), m_numChunksX(0), m_numChunksY(0)
+	{
+		Create(pLightSystem, width, height, tileDims, origin, chunkSize);
+	}
+
+	HullTileMap::~HullTileMap()
+	{
+		// Hulls stay in the light system, which destroys them
+	}
+
+	void HullTileMap::Create(LightSystem* pLightSystem, int width, int height, const Vec2f &tileDims, const Vec2f &origin, int chunkSize)
+	{
+		assert(pLightSystem != NULL);
+		assert(width > 0 && height > 0 && chunkSize > 0);
+
+		Clear();
+
+		m_pLightSystem = pLightSystem;
+		m_width = width;
+		m_height = height;
+		m_tileDims = tileDims;
+		m_origin = origin;
+		m_chunkSize = chunkSize;
+
+		m_numChunksX = (m_width + m_chunkSize - 1) / m_chunkSize;
+		m_numChunksY = (m_height + m_chunkSize - 1) / m_chunkSize;
+
+		m_tiles.assign(m_width * m_height, false);
+
+		m_chunkHulls.clear();
+		m_chunkHulls.resize(m_numChunksX * m_numChunksY);
+		m_chunkDirty.assign(m_numChunksX * m_numChunksY, false);
+	}
+
+	void HullTileMap::SetTile(int x, int y, bool solid)
+	{
+		assert(x >= 0 && x < m_width && y >= 0 && y < m_height);
+
+		if(m_tiles[x + y * m_width] == solid)
+			return;
+
+		m_tiles[x + y * m_width] = solid;
+
+		m_chunkDirty[x / m_chunkSize + (y / m_chunkSize) * m_numChunksX] = true;
+	}
+
+	bool HullTileMap::GetTile(int x, int y) const
+	{
+		if(x < 0 || x >= m_width || y < 0 || y >= m_height)
+			return false;
+
+		return m_tiles[x + y * m_width];
+	}
+
+	void HullTileMap::InvalidateRegion(int lowerX, int lowerY, int upperX, int upperY)
+	{
+		lowerX = std::max(lowerX, 0) / m_chunkSize;
+		lowerY = std::max(lowerY, 0) / m_chunkSize;
+		upperX = std::min(upperX, m_width - 1) / m_chunkSize;
+		upperY = std::min(upperY, m_height - 1) / m_chunkSize;
+
+		for(int cy = lowerY; cy <= upperY; cy++)
+			for(int cx = lowerX; cx <= upperX; cx++)
+				m_chunkDirty[cx + cy * m_numChunksX] = true;
+	}
+
+	void HullTileMap::Update()
+	{
+		std::vector<TileRect> rects;
+
+		for(int cy = 0; cy < m_numChunksY; cy++)
+			for(int cx = 0; cx < m_numChunksX; cx++)
+			{
+				const int chunkIndex = cx + cy * m_numChunksX;
+
+				if(!m_chunkDirty[chunkIndex])
+					continue;
+
+				MergeChunk(cx, cy, rects);
+
+				// Hulls joined across the seams may reach into chunks that did not change
+				while(!m_chunkHulls[chunkIndex].empty())
+					RemoveHull(m_chunkHulls[chunkIndex].back(), rects);
+			}
+
+		std::fill(m_chunkDirty.begin(), m_chunkDirty.end(), false);
+
+		JoinRects(rects);
+
+		for(unsigned int i = 0, numRects = rects.size(); i < numRects; i++)
+			AddHull(rects[i]);
+	}
+
+	void HullTileMap::Clear()
+	{
+		for(std::unordered_map<ConvexHull*, TileRect>::iterator it = m_hullRects.begin(); it != m_hullRects.end(); it++)
+			m_pLightSystem->RemoveConvexHull(it->first);
+
+		m_hullRects.clear();
+
+		for(unsigned int i = 0, numChunks = m_chunkHulls.size(); i < numChunks; i++)
+			m_chunkHulls[i].clear();
+	}
+
+	unsigned int HullTileMap::GetNumHulls() const
+	{
+		return m_hullRects.size();
+	}
+
+	void HullTileMap::AddHull(const TileRect &rect)
+	{
+		ConvexHull* pHull = CreateHull(rect);
+
+		m_pLightSystem->AddConvexHull(pHull);
+
+		m_hullRects[pHull] = rect;
+
+		for(int cy = rect.m_y / m_chunkSize, upperY = (rect.m_y + rect.m_height - 1) / m_chunkSize; cy <= upperY; cy++)
+			for(int cx = rect.m_x / m_chunkSize, upperX = (rect.m_x + rect.m_width - 1) / m_chunkSize; cx <= upperX; cx++)
+				m_chunkHulls[cx + cy * m_numChunksX].push_back(pHull);
+	}
+
+	void HullTileMap::RemoveHull(ConvexHull* pHull, std::vector<TileRect> &rects)
+	{
+		std::unordered_map<ConvexHull*, TileRect>::iterator it = m_hullRects.find(pHull);
+
+		assert(it != m_hullRects.end());
+
+		const TileRect rect = it->second;
+
+		for(int cy = rect.m_y / m_chunkSize, upperY = (rect.m_y + rect.m_height - 1) / m_chunkSize; cy <= upperY; cy++)
+			for(int cx = rect.m_x / m_chunkSize, upperX = (rect.m_x + rect.m_width - 1) / m_chunkSize; cx <= upperX; cx++)
+			{
+				const int chunkIndex = cx + cy * m_numChunksX;
+
+				std::vector<ConvexHull*> &hulls = m_chunkHulls[chunkIndex];
+				hulls.erase(std::find(hulls.begin(), hulls.end(), pHull));
+
+				// Dirty chunks are merged again anyway
+				if(m_chunkDirty[chunkIndex])
+					continue;
+
+				TileRect part;
+				part.m_x = std::max(rect.m_x, cx * m_chunkSize);
+				part.m_y = std::max(rect.m_y, cy * m_chunkSize);
+				part.m_width = std::min(rect.m_x + rect.m_width, (cx + 1) * m_chunkSize) - part.m_x;
+				part.m_height = std::min(rect.m_y + rect.m_height, (cy + 1) * m_chunkSize) - part.m_y;
+
+				rects.push_back(part);
+			}
+
+		m_hullRects.erase(it);
+
+		m_pLightSystem->RemoveConvexHull(pHull);
+	}
+
+	void HullTileMap::MergeChunk(int chunkX, int chunkY, std::vector<TileRect> &rects)
+	{
+		const int lowerX = chunkX * m_chunkSize;
+		const int lowerY = chunkY * m_chunkSize;
+		const int upperX = std::min(lowerX + m_chunkSize, m_width);
+		const int upperY = std::min(lowerY + m_chunkSize, m_height);
+
+		const int chunkWidth = upperX - lowerX;
+
+		// Tiles already covered by a rectangle
+		std::vector<bool> used(chunkWidth * (upperY - lowerY), false);
+
+		// Greedy rectangle merging: grow along x first, then along y as long as whole rows are solid
+		for(int y = lowerY; y < upperY; y++)
+			for(int x = lowerX; x < upperX; x++)
+			{
+				if(!m_tiles[x + y * m_width] || used[(x - lowerX) + (y - lowerY) * chunkWidth])
+					continue;
+
+				TileRect rect;
+				rect.m_x = x;
+				rect.m_y = y;
+				rect.m_width = 1;
+				rect.m_height = 1;
+
+				while(x + rect.m_width < upperX &&
+					m_tiles[x + rect.m_width + y * m_width] &&
+					!used[(x + rect.m_width - lowerX) + (y - lowerY) * chunkWidth])
+					rect.m_width++;
+
+				for(bool rowSolid = true; rowSolid && y + rect.m_height < upperY;)
+				{
+					const int rowY = y + rect.m_height;
+
+					for(int rx = x; rx < x + rect.m_width; rx++)
+						if(!m_tiles[rx + rowY * m_width] || used[(rx - lowerX) + (rowY - lowerY) * chunkWidth])
+						{
+							rowSolid = false;
+							break;
+						}
+
+					if(rowSolid)
+						rect.m_height++;
+				}
+
+				for(int ry = y; ry < y + rect.m_height; ry++)
+					for(int rx = x; rx < x + rect.m_width; rx++)
+						used[(rx - lowerX) + (ry - lowerY) * chunkWidth] = true;
+
+				rects.push_back(rect);
+			}
+	}
+
+	void HullTileMap::JoinRects(std::vector<TileRect> &rects)
+	{
+		for(bool joined = true; joined;)
+		{
+			joined = false;
+
+			// Side by side with the same rows, then on top of each other with the same columns
+			for(int vertical = 0; vertical < 2; vertical++)
+			{
+				// Rectangles by where they start along the joining axis, where they start across it, and their size across it.
+				// Rectangles do not overlap, so no two share a key
+				std::map<std::tuple<int, int, int>, unsigned int> starts;
+
+				for(unsigned int i = 0, numRects = rects.size(); i < numRects; i++)
+				{
+					const TileRect &rect = rects[i];
+
+					starts[vertical ? std::make_tuple(rect.m_y, rect.m_x, rect.m_width) : std::make_tuple(rect.m_x, rect.m_y, rect.m_height)] = i;
+				}
+
+				std::vector<bool> removed(rects.size(), false);
+
+				for(unsigned int i = 0, numRects = rects.size(); i < numRects; i++)
+				{
+					if(removed[i])
+						continue;
+
+					TileRect &rect = rects[i];
+
+					// Keep growing while a rectangle starts where this one ends
+					for(;;)
+					{
+						std::map<std::tuple<int, int, int>, unsigned int>::iterator it = starts.find(vertical ?
+							std::make_tuple(rect.m_y + rect.m_height, rect.m_x, rect.m_width) : std::make_tuple(rect.m_x + rect.m_width, rect.m_y, rect.m_height));
+
+						if(it == starts.end())
+							break;
+
+						const unsigned int other = it->second;
+
+						if(vertical)
+							rect.m_height += rects[other].m_height;
+						else
+							rect.m_width += rects[other].m_width;
+
+						removed[other] = true;
+						starts.erase(it);
+
+						joined = true;
+					}
+				}
+
+				unsigned int numKept = 0;
+
+				for(unsigned int i = 0, numRects = rects.size(); i < numRects; i++)
+					if(!removed[i])
+						rects[numKept++] = rects[i];
+
+				rects.resize(numKept);
+			}
+		}
+	}
+
+	ConvexHull* HullTileMap::CreateHull(const TileRect &rect)
+	{
+		ConvexHull* pHull = new ConvexHull();
+
+		Vec2f halfDims(rect.m_width * m_tileDims.x / 2.0f, rect.m_height * m_tileDims.y / 2.0f);
+
+		// Same winding as the shapes loaded from file
+		pHull->m_vertices.push_back(Vec2f(-halfDims.x, -halfDims.y));
+		pHull->m_vertices.push_back(Vec2f(halfDims.x, -halfDims.y));
+		pHull->m_vertices.push_back(Vec2f(halfDims.x, halfDims.y));
+		pHull->m_vertices.push_back(Vec2f(-halfDims.x, halfDims.y));
+
+		pHull->CalculateNormals();
+		pHull->CalculateAABB();
+
+		pHull->SetWorldCenter(Vec2f(m_origin.x + rect.m_x * m_tileDims.x + halfDims.x, m_origin.y + rect.m_y * m_tileDims.y + halfDims.y));
+
+		return pHull;
+	}
+}
@@ -20,28 +20,34 @@
 */
 
 #include <LTBL/Light/Light.h>
+#include <LTBL/Utils.h>
 
 #include <cassert>
 
 namespace ltbl
 {
 	Light::Light()
-		: m_intensity(1.0f),
-		m_radius(100.0f),
+		: m_staticFrame(0), // For static light
+		m_cachedCenter(0.0f, 0.0f), m_cachedRadius(0.0f), m_cachedFrame(0), m_hullDrift(0.0f), m_amortized(false), m_previousCenter(0.0f, 0.0f), // For amortized dynamic light
+		m_alwaysUpdate(true),
+		m_pWin(NULL),
+		m_updateRequired(true),
+		m_pLightSystem(NULL),
+		m_shaderAttenuation(true),
+		m_detail(1.0f),
 		m_center(0.0f, 0.0f),
-		m_color(1.0f, 1.0f, 1.0f),
+		m_intensity(1.0f),
+		m_radius(100.0f),
 		m_size(40.0f),
-		m_updateRequired(true), m_alwaysUpdate(true), m_pStaticTexture(NULL), // For static light
-		m_pWin(NULL), m_pLightSystem(NULL), m_shaderAttenuation(true),
-		m_bleed(1.0f), m_linearizeFactor(0.2f)
+		m_bleed(1.0f),
+		m_linearizeFactor(0.2f),
+		m_color(1.0f, 1.0f, 1.0f)
 	{
 	}
 
 	Light::~Light()
 	{
-		// Destroy the static Texture if one exists
-		if(m_alwaysUpdate)
-			delete m_pStaticTexture;
+		// The static region is freed by the light system
 	}
 
 	AABB* Light::GetAABB()
@@ -59,7 +65,7 @@ namespace ltbl
 		// Must add to the light system before calling this
 		assert(m_pWin != NULL);
 
-		if(!always && m_alwaysUpdate) // If previously set to false, create a render Texture for the static texture
+		if(!always && m_alwaysUpdate) // If previously set to false, the light system caches the light in its static atlas
 		{
 			Vec2f dims(m_aabb.GetDims());
 
@@ -72,45 +78,12 @@ namespace ltbl
 				return;
 			}
 
-			// Create the render Texture based on aabb dims
-			m_pStaticTexture = new sf::RenderTexture();
-
-			unsigned int uiDimsX = static_cast<unsigned int>(dims.x);
-			unsigned int uiDimsY = static_cast<unsigned int>(dims.y);
-
-			m_pStaticTexture->create(uiDimsX, uiDimsY, false);
-
-			m_pStaticTexture->setSmooth(true);
-
-			m_pStaticTexture->setActive();
-			glEnable(GL_BLEND);
-			glEnable(GL_TEXTURE_2D);
-			m_pWin->setActive();
-
 			m_updateRequired = true;
 		}
-		else if(always && !m_alwaysUpdate) // If previously set to true, destroy the render Texture
-			delete m_pStaticTexture;
 	
 		m_alwaysUpdate = always;
 	}
 
-	void Light::SwitchStaticTexture()
-	{
-		Vec2f dims(m_aabb.GetDims());
-
-		m_pStaticTexture->setActive();
-
-		glViewport(0, 0, static_cast<unsigned int>(dims.x), static_cast<unsigned int>(dims.y));
-
-		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-
-		// Flip the projection, since SFML draws the bound textures (on the FBO) upside down
-		glOrtho(0, static_cast<unsigned int>(dims.x), static_cast<unsigned int>(dims.y), 0, -100.0f, 100.0f);
-		glMatrixMode(GL_MODELVIEW);
-	}
-
 	void Light::SetRadius(float radius)
 	{
 		assert(m_alwaysUpdate);
@@ -170,4 +143,15 @@ namespace ltbl
 		m_aabb.SetCenter(m_center);
 		m_aabb.SetDims(Vec2f(m_radius, m_radius));
 	}
+
+	void Light::GetAngularRange(float &lowerAngle, float &upperAngle)
+	{
+		lowerAngle = 0.0f;
+		upperAngle = pifTimes2;
+	}
+
+	bool Light::HasSoftPortion()
+	{
+		return true;
+	}
 }
@@ -0,0 +1,80 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <LTBL/Light/LightBatch.h>
+#include <LTBL/Utils.h>
+
+#include <string>
+
+namespace ltbl
+{
+	LightBatch::LightBatch()
+		: m_available(false)
+	{
+	}
+
+	void LightBatch::Create(bool useVertexBuffer)
+	{
+		m_quads.Create(useVertexBuffer);
+
+		if(!sf::Shader::isAvailable())
+			return;
+
+		const std::string fragmentShaderSource =
+			"varying vec3 light;\n"
+			"varying vec4 params;\n" +
+			LightQuads::GetAttenuationSource() +
+			"void main()\n"
+			"{\n"
+			"	float attenuation = Attenuation(length(light.xy - gl_FragCoord.xy), light.z, params.x, params.y);\n"
+			"	gl_FragColor = vec4(gl_Color.rgb * attenuation, 1.0);\n"
+			"}\n";
+
+		m_available = m_shader.loadFromMemory(LightQuads::GetVertexShaderSource(), fragmentShaderSource);
+	}
+
+	bool LightBatch::Available() const
+	{
+		return m_available;
+	}
+
+	void LightBatch::Clear()
+	{
+		m_quads.Clear();
+	}
+
+	bool LightBatch::Empty() const
+	{
+		return m_quads.Empty();
+	}
+
+	void LightBatch::AddLight(const Vec2f &center, float radius, const Color3f &color, float bleed, float linearizeFactor, const Vec2f &pixelOffset, float pixelScale)
+	{
+		m_quads.AddLight(center, radius, 0.0f, color, bleed, linearizeFactor, 0.0f, pifTimes2, 0.0f, pixelOffset, pixelScale);
+	}
+
+	void LightBatch::Render()
+	{
+		m_quads.Render(m_shader);
+		m_quads.Clear();
+	}
+}
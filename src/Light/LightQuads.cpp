@@ -0,0 +1,161 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
+#include <LTBL/Light/LightQuads.h>
+#include <LTBL/Utils.h>
+
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace ltbl
+{
+	void LightQuads::Create(bool useVertexBuffer)
+	{
+		m_stream.Create(useVertexBuffer);
+	}
+
+	std::string LightQuads::GetAttenuationSource()
+	{
+		return
+			"float Attenuation(float dist, float radius, float bleed, float linearizeFactor)\n"
+			"{\n"
+			"	return clamp((radius - dist) * (bleed / pow(dist, 2.0) + linearizeFactor / radius), 0.0, 1.0);\n"
+			"}\n";
+	}
+
+	std::string LightQuads::GetVertexShaderSource()
+	{
+		return
+			"varying vec3 light;\n"
+			"varying vec4 params;\n"
+			"varying vec2 range;\n"
+			"void main()\n"
+			"{\n"
+			"	gl_Position = ftransform();\n"
+			"	gl_FrontColor = gl_Color;\n"
+			"	light = gl_MultiTexCoord0.xyz;\n"
+			"	params = gl_MultiTexCoord1;\n"
+			"	range = gl_MultiTexCoord2.xy;\n"
+			"}\n";
+	}
+
+	void LightQuads::Clear()
+	{
+		m_vertices.clear();
+	}
+
+	bool LightQuads::Empty() const
+	{
+		return m_vertices.empty();
+	}
+
+	void LightQuads::AddLight(const Vec2f &center, float radius, float size, const Color3f &color, float bleed, float linearizeFactor,
+		float lowerAngle, float upperAngle, float extra, const Vec2f &pixelOffset, float pixelScale)
+	{
+		Vertex vertex;
+
+		// The bleed term falls off with the square of the distance, so it scales along with the distances to stay the same
+		vertex.m_centerX = (center.x + pixelOffset.x) * pixelScale;
+		vertex.m_centerY = (center.y + pixelOffset.y) * pixelScale;
+		vertex.m_radius = radius * pixelScale;
+		vertex.m_bleed = bleed * pixelScale;
+		vertex.m_linearizeFactor = linearizeFactor;
+		vertex.m_size = size * pixelScale;
+		vertex.m_extra = extra;
+		vertex.m_lowerAngle = lowerAngle;
+		vertex.m_angleRange = std::min(upperAngle - lowerAngle, pifTimes2);
+		vertex.m_r = color.r;
+		vertex.m_g = color.g;
+		vertex.m_b = color.b;
+
+		// Quad around the light disk, the attenuation is 0 outside of it
+		vertex.m_x = center.x - radius; vertex.m_y = center.y - radius;
+		m_vertices.push_back(vertex);
+
+		vertex.m_x = center.x + radius; vertex.m_y = center.y - radius;
+		m_vertices.push_back(vertex);
+
+		vertex.m_x = center.x + radius; vertex.m_y = center.y + radius;
+		m_vertices.push_back(vertex);
+
+		vertex.m_x = center.x - radius; vertex.m_y = center.y + radius;
+		m_vertices.push_back(vertex);
+	}
+
+	void LightQuads::Render(sf::Shader &shader)
+	{
+		if(m_vertices.empty())
+			return;
+
+		const char* pVertices = m_stream.Upload(&m_vertices[0], m_vertices.size() * sizeof(Vertex));
+
+		glDisable(GL_TEXTURE_2D);
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+
+		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_x));
+		glColorPointer(3, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_r));
+
+		glClientActiveTexture(GL_TEXTURE0);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(3, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_centerX));
+
+		glClientActiveTexture(GL_TEXTURE1);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(4, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_bleed));
+
+		glClientActiveTexture(GL_TEXTURE2);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_lowerAngle));
+
+		sf::Shader::bind(&shader);
+
+		glDrawArrays(GL_QUADS, 0, m_vertices.size());
+
+		sf::Shader::bind(NULL);
+
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+		glClientActiveTexture(GL_TEXTURE1);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+		glClientActiveTexture(GL_TEXTURE0);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glDisableClientState(GL_COLOR_ARRAY);
+
+		m_stream.Unbind();
+
+		glEnable(GL_TEXTURE_2D);
+
+		// Color arrays leave the current color undefined
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+}
@@ -19,34 +19,79 @@
 	3. This notice may not be removed or altered from any source distribution.
 */
 
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
 #include <LTBL/QuadTree/QuadTreeOccupant.h>
 #include <LTBL/Light/LightSystem.h>
+#include <LTBL/Light/LightQuads.h>
 #include <LTBL/Light/ShadowFin.h>
 #include <LTBL/Utils.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
+#include <limits>
 
 namespace ltbl
 {
 	LightSystem::LightSystem()
-		: m_ambientColor(55, 55, 55), m_checkForHullIntersect(true),
-		m_prebuildTimer(0), m_useBloom(true), m_maxFins(1)
+		: m_pWin(NULL),
+		m_extensionsLoaded(false),
+		m_batchCurrentLight(false),
+		m_maxFinsCurrentLight(1),
+		m_hardShadowsCurrentLight(false),
+		m_compositionStencilBuffer(0),
+		m_stencilAvailable(false),
+		m_appliedCompositionFormat(format_rgba8),
+		m_appliedBloomFormat(format_rgba8),
+		m_appliedLightMaskFormat(format_rgba8),
+		m_lightMaskShaderAvailable(false),
+		m_frame(0),
+		m_numStaticRebuilds(0),
+		m_appliedLightingScale(1.0f),
+		m_distanceFieldCreated(false),
+		m_bloomCreated(false),
+		m_pixelScale(1.0f),
+		m_lightingCPUTime(0.0f),
+		m_ambientColor(55, 55, 55),
+		m_checkForHullIntersect(true),
+		m_useBloom(true),
+		m_bloomThreshold(0.8f),
+		m_bloomQuality(BloomPipeline::quality_medium),
+		m_useOcclusionCulling(true),
+		m_clipShadows(true),
+		m_unionShadows(false),
+		m_useVisibilityPolygons(false),
+		m_batchShadows(true),
+		m_scissorLights(true),
+		m_useStencilShadows(false),
+		m_batchFreeLights(true),
+		m_tileFreeLights(false),
+		m_useShadowMaps(false),
+		m_useDistanceField(false),
+		m_extrudeShadows(false),
+		m_maxFins(1),
+		m_useLightLOD(true),
+		m_lightQuality(1.0f),
+		m_compositionFormat(format_rgba8),
+		m_bloomFormat(format_rgba8),
+		m_lightMaskFormat(format_r8),
+		m_lightingScale(1.0f),
+		m_maxStaticRebuilds(0),
+		m_staticRebuildTime(2.0f),
+		m_staticTextureBudget(64 * 1024 * 1024),
+		m_dynamicUpdateThreshold(0.0f),
+		m_maxDynamicRebuilds(16),
+		m_useGovernor(false)
 	{
 	}
 
 	LightSystem::LightSystem(const AABB &region, sf::RenderWindow* pRenderWindow, const std::string &finImagePath, const std::string &lightAttenuationShaderPath)
-		: m_ambientColor(55, 55, 55), m_checkForHullIntersect(true),
-		m_prebuildTimer(0), m_pWin(pRenderWindow), m_useBloom(true), m_maxFins(1)
+		: LightSystem()
 	{
-		// Load the soft shadows texture
-		if(!m_softShadowTexture.loadFromFile(finImagePath))
-			std::abort(); // Could not find the texture, abort
-
-		if(!m_lightAttenuationShader.loadFromFile(lightAttenuationShaderPath, sf::Shader::Fragment))
-			std::abort();
-
-		SetUp(region);
+		Create(region, pRenderWindow, finImagePath, lightAttenuationShaderPath);
 	}
 
 	LightSystem::~LightSystem()
@@ -55,6 +100,12 @@ namespace ltbl
 		ClearLights();
 		ClearConvexHulls();
 		ClearEmissiveLights();
+
+		if(m_compositionStencilBuffer != 0)
+			glDeleteRenderbuffersEXT(1, &m_compositionStencilBuffer);
+
+		// The timer queries are deleted after this, and belong to the context of the composition texture
+		m_compositionTexture.setActive();
 	}
 
 	void LightSystem::Create(const AABB &region, sf::RenderWindow* pRenderWindow, const std::string &finImagePath, const std::string &lightAttenuationShaderPath)
@@ -87,13 +138,27 @@ namespace ltbl
 		glTranslatef(-m_viewAABB.m_lowerBound.x, -m_viewAABB.m_lowerBound.y, 0.0f);
 	}
 
-	void LightSystem::MaskShadow(Light* light, ConvexHull* convexHull, bool minPoly, float depth)
+	bool LightSystem::CastsShadow(Light* pLight, ConvexHull* pHull)
+	{
+		if(!m_checkForHullIntersect)
+			return true;
+
+		Vec2f hullToLight(pLight->m_center - pHull->GetWorldCenter());
+		hullToLight = hullToLight.Normalize() * pLight->m_size;
+
+		return !pHull->PointInsideHull(pLight->m_center - hullToLight);
+	}
+
+	void LightSystem::MaskShadow(Light* light, ConvexHull* convexHull, bool minPoly, float depth, const ClipRegion* pClipRegion, bool renderUmbra)
 	{
 		// ----------------------------- Determine the Shadow Boundaries -----------------------------
 
 		Vec2f lCenter(light->m_center);
 		float lRadius = light->m_radius;
 
+		// Hard shadows are cast from the center
+		const float lSize = m_hardShadowsCurrentLight ? 0.0f : light->m_size;
+
 		Vec2f hCenter(convexHull->GetWorldCenter());
 
 		const int numVertices = convexHull->m_vertices.size();
@@ -115,7 +180,7 @@ namespace ltbl
 			if(centerToBoundry.Dot(lightNormal) < 0)
 				lightNormal *= -1;
 
-			lightNormal = lightNormal.Normalize() * light->m_size;
+			lightNormal = lightNormal.Normalize() * lSize;
 
 			Vec2f L((lCenter - lightNormal) - middle);
                 
@@ -150,7 +215,7 @@ namespace ltbl
 		if(centerToBoundry.Dot(lightNormal) < 0)
 			lightNormal *= -1;
 
-		lightNormal = lightNormal.Normalize() * light->m_size;
+		lightNormal = lightNormal.Normalize() * lSize;
 
 		ShadowFin firstFin;
 
@@ -173,7 +238,7 @@ namespace ltbl
 		if(centerToBoundry.Dot(lightNormal) < 0)
 			lightNormal *= -1;
 
-		lightNormal = lightNormal.Normalize() * light->m_size;
+		lightNormal = lightNormal.Normalize() * lSize;
 
 		secondFin.m_rootPos = secondBoundryPoint;
 		secondFin.m_umbra = secondBoundryPoint - (lCenter + lightNormal);
@@ -205,61 +270,85 @@ namespace ltbl
 
 		// ----------------------------- Drawing the umbra -----------------------------
 
-		glDisable(GL_TEXTURE_2D);
+		if(renderUmbra)
+		{
+			if(!m_batchCurrentLight)
+			{
+				glDisable(GL_TEXTURE_2D);
 
-		glBlendFunc(GL_ZERO, GL_SRC_ALPHA);
+				glBlendFunc(GL_ZERO, GL_SRC_ALPHA);
 
-		glColor4f(0.0f, 0.0f, 0.0f, 1.0f - convexHull->m_transparency);
+				glColor4f(0.0f, 0.0f, 0.0f, 1.0f - convexHull->m_transparency);
+			}
 
-		if(!convexHull->m_renderLightOverHull)
-		{
-			Vec2f throughCenter((hCenter - lCenter).Normalize() * lRadius);
+			m_umbraStrip.clear();
 
-			// 3 rays all the time, less polygons
-			glBegin(GL_TRIANGLE_STRIP);
+			if(!convexHull->m_renderLightOverHull)
+			{
+				Vec2f throughCenter((hCenter - lCenter).Normalize() * lRadius);
+
+				// 3 rays all the time, less polygons
+				m_umbraStrip.push_back(mainUmbraRoot1);
+				m_umbraStrip.push_back(mainUmbraRoot1 + mainUmbraVec1);
+				m_umbraStrip.push_back(hCenter);
+				m_umbraStrip.push_back(hCenter + throughCenter);
+				m_umbraStrip.push_back(mainUmbraRoot2);
+				m_umbraStrip.push_back(mainUmbraRoot2 + mainUmbraVec2);
+			}
+			else
+			{
+				// Umbra and penumbra sides done separately, since they do not follow light rays
+				m_umbraStrip.push_back(mainUmbraRoot1);
+				m_umbraStrip.push_back(mainUmbraRoot1 + mainUmbraVec1);
 
-			glVertex3f(mainUmbraRoot1.x, mainUmbraRoot1.y, depth);
-			glVertex3f(mainUmbraRoot1.x + mainUmbraVec1.x, mainUmbraRoot1.y + mainUmbraVec1.y, depth);
-			glVertex3f(hCenter.x, hCenter.y, depth);
-			glVertex3f(hCenter.x + throughCenter.x, hCenter.y + throughCenter.y, depth);
-			glVertex3f(mainUmbraRoot2.x, mainUmbraRoot2.y, depth);
-			glVertex3f(mainUmbraRoot2.x + mainUmbraVec2.x, mainUmbraRoot2.y + mainUmbraVec2.y, depth);
+				int endV; 
 
-			glEnd();
-		}
-		else
-		{
-			glBegin(GL_TRIANGLE_STRIP);
+				if(firstBoundryIndex < secondBoundryIndex)
+					endV = secondBoundryIndex - 1;
+				else
+					endV = secondBoundryIndex + numVertices - 1;
 
-			// Umbra and penumbra sides done separately, since they do not follow light rays
-			glVertex3f(mainUmbraRoot1.x, mainUmbraRoot1.y, depth);
-			glVertex3f(mainUmbraRoot1.x + mainUmbraVec1.x, mainUmbraRoot1.y + mainUmbraVec1.y, depth);
+				// Mask off around the hull, requires more polygons
+				for(int v = firstBoundryIndex + 1; v <= endV; v++)
+				{
+					// Get actual vertex
+					int vi = v % numVertices;
 
-			int endV; 
+					Vec2f startVert(convexHull->GetWorldVertex(vi));
+					Vec2f endVert((startVert - light->m_center).Normalize() * light->m_radius + startVert);
 
-			if(firstBoundryIndex < secondBoundryIndex)
-				endV = secondBoundryIndex - 1;
-			else
-				endV = secondBoundryIndex + numVertices - 1;
+					// 2 points for ray in strip
+					m_umbraStrip.push_back(startVert);
+					m_umbraStrip.push_back(endVert);
+				}
 
-			// Mask off around the hull, requires more polygons
-			for(int v = firstBoundryIndex + 1; v <= endV; v++)
-			{
-				// Get actual vertex
-				int vi = v % numVertices;
+				m_umbraStrip.push_back(mainUmbraRoot2);
+				m_umbraStrip.push_back(mainUmbraRoot2 + mainUmbraVec2);
+			}
+
+			// Opaque umbras are rendered later on, all at once
+			if(m_unionShadows && convexHull->m_transparency == 1.0f)
+				m_shadowUnion.AddStrip(m_umbraStrip, pClipRegion);
+			else if(m_batchCurrentLight)
+				m_shadowBatch.AddTriangleStrip(convexHull->m_transparency == 1.0f ? ShadowBatch::blend_umbra : ShadowBatch::blend_multiply,
+					m_umbraStrip, Vec2f(1.0f, 1.0f), depth, 1.0f - convexHull->m_transparency, pClipRegion);
+			else
+				RenderUmbraStrip(m_umbraStrip, depth, pClipRegion);
+		}
 
-				Vec2f startVert(convexHull->GetWorldVertex(vi));
-				Vec2f endVert((startVert - light->m_center).Normalize() * light->m_radius + startVert);
+		// Without a penumbra the fins have no area
+		if(m_hardShadowsCurrentLight)
+			return;
 
-				// 2 points for ray in strip
-				glVertex3f(startVert.x, startVert.y, depth);
-				glVertex3f(endVert.x, endVert.y, depth);
-			}
+		if(m_batchCurrentLight)
+		{
+			for(unsigned int f = 0, numFins = finsToRender_firstBoundary.size(); f < numFins; f++)
+				finsToRender_firstBoundary[f].AddToBatch(m_shadowBatch, convexHull->m_transparency, pClipRegion);
 
-			glVertex3f(mainUmbraRoot2.x, mainUmbraRoot2.y, depth);
-			glVertex3f(mainUmbraRoot2.x + mainUmbraVec2.x, mainUmbraRoot2.y + mainUmbraVec2.y, depth);
+			for(unsigned int f = 0, numFins = finsToRender_secondBoundary.size(); f < numFins; f++)
+				finsToRender_secondBoundary[f].AddToBatch(m_shadowBatch, convexHull->m_transparency, pClipRegion);
 
-			glEnd();
+			return;
 		}
 
 		// Render shadow fins
@@ -270,10 +359,87 @@ namespace ltbl
 		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 
 		for(unsigned int f = 0, numFins = finsToRender_firstBoundary.size(); f < numFins; f++)
-			finsToRender_firstBoundary[f].Render(convexHull->m_transparency);
+			finsToRender_firstBoundary[f].Render(convexHull->m_transparency, pClipRegion);
 
 		for(unsigned int f = 0, numFins = finsToRender_secondBoundary.size(); f < numFins; f++)
-			finsToRender_secondBoundary[f].Render(convexHull->m_transparency);
+			finsToRender_secondBoundary[f].Render(convexHull->m_transparency, pClipRegion);
+	}
+
+	void LightSystem::MaskShadows(Light* pLight, const std::vector<qdt::QuadTreeOccupant*> &shadowHulls, const ClipRegion* pClipRegion, bool useVisibilityPolygon)
+	{
+		const unsigned int numShadowHulls = shadowHulls.size();
+
+		// Mask off lights
+		for(unsigned int h = 0; h < numShadowHulls; h++)
+		{
+			ConvexHull* pHull = static_cast<ConvexHull*>(shadowHulls[h]);
+
+			if(!CastsShadow(pLight, pHull))
+				continue;
+
+			// Umbras of opaque hulls are already missing from the visibility polygon, only the fins remain
+			MaskShadow(pLight, pHull, !pHull->m_renderLightOverHull, 2.0f, pClipRegion, !useVisibilityPolygon || pHull->m_transparency != 1.0f);
+		}
+
+		if(m_unionShadows && m_batchCurrentLight)
+			m_shadowUnion.AddToBatch(m_shadowBatch, Vec2f(1.0f, 1.0f), 2.0f);
+		else if(m_unionShadows && !m_shadowUnion.Empty())
+		{
+			glDisable(GL_TEXTURE_2D);
+
+			glBlendFunc(GL_ZERO, GL_SRC_ALPHA);
+
+			// Opaque, so alpha is 0
+			glColor4f(0.0f, 0.0f, 0.0f, 0.0f);
+
+			m_shadowUnion.Render(2.0f);
+
+			glEnable(GL_TEXTURE_2D);
+
+			glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+		}
+	}
+
+	void LightSystem::RenderUmbraStrip(const std::vector<Vec2f> &strip, float depth, const ClipRegion* pClipRegion)
+	{
+		const unsigned int numStripVertices = strip.size();
+
+		if(pClipRegion == NULL)
+		{
+			glBegin(GL_TRIANGLE_STRIP);
+
+			for(unsigned int i = 0; i < numStripVertices; i++)
+				glVertex3f(strip[i].x, strip[i].y, depth);
+
+			glEnd();
+
+			return;
+		}
+
+		// Clip each triangle of the strip on its own, they are convex
+		std::vector<Vec2f> positions;
+		std::vector<Vec2f> noTexCoords;
+
+		for(unsigned int i = 2; i < numStripVertices; i++)
+		{
+			positions.resize(3);
+
+			positions[0] = strip[i - 2];
+			positions[1] = strip[i - 1];
+			positions[2] = strip[i];
+
+			pClipRegion->ClipPolygon(positions, noTexCoords);
+
+			if(positions.empty())
+				continue;
+
+			glBegin(GL_TRIANGLE_FAN);
+
+			for(unsigned int v = 0, numVertices = positions.size(); v < numVertices; v++)
+				glVertex3f(positions[v].x, positions[v].y, depth);
+
+			glEnd();
+		}
 	}
 
 	int LightSystem::AddExtraFins(const ConvexHull &hull, std::vector<ShadowFin> &fins, const Light &light, int boundryIndex, bool wrapCW, Vec2f &mainUmbraRoot, Vec2f &mainUmbraVec)
@@ -290,7 +456,7 @@ namespace ltbl
 
 		unsigned int i;
 
-		for(i = 0; i < m_maxFins; i++)
+		for(i = 0; i < m_maxFinsCurrentLight; i++)
 		{	
 			if(wrapCW)
 				secondEdgeIndex = Wrap(boundryIndex - 1, numVertices);
@@ -344,6 +510,95 @@ namespace ltbl
 		return i;
 	}
 
+	bool LightSystem::HullOcclusionInfo::operator<(const HullOcclusionInfo &other) const
+	{
+		return m_nearDistance < other.m_nearDistance;
+	}
+
+	void LightSystem::CullOccludedHulls(Light* pLight, const std::vector<qdt::QuadTreeOccupant*> &regionHulls, std::vector<qdt::QuadTreeOccupant*> &shadowHulls)
+	{
+		const Vec2f lCenter(pLight->m_center);
+
+		m_hullOcclusionInfos.clear();
+
+		for(unsigned int h = 0, numHulls = regionHulls.size(); h < numHulls; h++)
+		{
+			ConvexHull* pHull = static_cast<ConvexHull*>(regionHulls[h]);
+
+			HullOcclusionInfo info;
+			info.m_pHull = pHull;
+
+			Vec2f toCenter(pHull->GetWorldCenter() - lCenter);
+
+			// Measure angles relative to the direction towards the hull, so they do not wrap
+			float lowerRel = pif;
+			float upperRel = -pif;
+
+			info.m_nearDistance = std::numeric_limits<float>::max();
+			info.m_farDistance = 0.0f;
+
+			const int numVertices = pHull->m_vertices.size();
+
+			for(int i = 0; i < numVertices; i++)
+			{
+				Vec2f v(pHull->GetWorldVertex(i) - lCenter);
+				Vec2f w(pHull->GetWorldVertex(Wrap(i + 1, numVertices)) - lCenter);
+
+				float rel = std::atan2(toCenter.Cross(v), toCenter.Dot(v));
+
+				lowerRel = std::min(lowerRel, rel);
+				upperRel = std::max(upperRel, rel);
+
+				info.m_farDistance = std::max(info.m_farDistance, v.Magnitude());
+
+				// Closest point on the edge to the light
+				Vec2f edge(w - v);
+				float edgeLengthSquared = edge.MagnitudeSquared();
+				float t = edgeLengthSquared > 0.0f ? std::min(std::max(-v.Dot(edge) / edgeLengthSquared, 0.0f), 1.0f) : 0.0f;
+
+				info.m_nearDistance = std::min(info.m_nearDistance, (v + edge * t).Magnitude());
+			}
+
+			// If all vertices lie within half a circle, the light is outside of the hull
+			info.m_bounded = numVertices > 0 && toCenter.MagnitudeSquared() > 0.0f && upperRel - lowerRel < pif && info.m_nearDistance > 0.0f;
+
+			float refAngle = std::atan2(toCenter.y, toCenter.x);
+
+			info.m_lowerAngle = refAngle + lowerRel;
+			info.m_upperAngle = refAngle + upperRel;
+
+			m_hullOcclusionInfos.push_back(info);
+		}
+
+		std::sort(m_hullOcclusionInfos.begin(), m_hullOcclusionInfos.end());
+
+		m_occlusionCoverage.Clear();
+
+		for(unsigned int h = 0, numHulls = m_hullOcclusionInfos.size(); h < numHulls; h++)
+		{
+			const HullOcclusionInfo &info = m_hullOcclusionInfos[h];
+
+			if(!info.m_bounded)
+			{
+				shadowHulls.push_back(info.m_pHull);
+				continue;
+			}
+
+			// Angle by which the light size widens the penumbra and narrows the umbra
+			float penumbraAngle = std::atan(pLight->m_size / info.m_nearDistance);
+
+			// Hidden, including its fins
+			if(m_occlusionCoverage.Covered(info.m_lowerAngle - penumbraAngle, info.m_upperAngle + penumbraAngle, info.m_nearDistance))
+				continue;
+
+			shadowHulls.push_back(info.m_pHull);
+
+			// Only fully opaque hulls hide what is behind them
+			if(info.m_pHull->m_transparency == 1.0f)
+				m_occlusionCoverage.Add(info.m_lowerAngle + penumbraAngle, info.m_upperAngle - penumbraAngle, info.m_farDistance);
+		}
+	}
+
 	void LightSystem::SetUp(const AABB &region)
 	{
 		// Create the quad trees
@@ -351,147 +606,691 @@ namespace ltbl
 		m_hullTree.Create(region);
 		m_emissiveTree.Create(region);
 
+		// Load the extensions used by the vertex buffer backends, from the window context
+		m_pWin->setActive();
+
+		m_extensionsLoaded = glewInit() == GLEW_OK;
+
+		m_shadowBatch.Create(m_extensionsLoaded && GLEW_VERSION_1_5);
+		m_freeLightBatch.Create(m_extensionsLoaded && GLEW_VERSION_1_5);
+		m_bloomLightBatch.Create(m_extensionsLoaded && GLEW_VERSION_1_5);
+		m_hullEdgeBuffer.Create(m_extensionsLoaded && GLEW_VERSION_1_5);
+		m_shadowMap.Create(m_extensionsLoaded && GLEW_VERSION_1_5);
+		m_tiledLightGrid.Create();
+		m_emissiveBatch.Create(m_extensionsLoaded && GLEW_VERSION_1_5);
+		m_staticLightAtlas.Create(m_extensionsLoaded && GLEW_VERSION_1_5);
+
+		CreateRenderTextures();
+
+		if(sf::Shader::isAvailable())
+		{
+			// The light is white, so the red channel holds it for all formats
+			const std::string lightMaskShaderSource =
+				"uniform sampler2D mask;\n"
+				"uniform vec3 tint;\n"
+				"void main()\n"
+				"{\n"
+				"	gl_FragColor = vec4(tint * texture2D(mask, gl_TexCoord[0].xy).r, 1.0);\n"
+				"}\n";
+
+			m_lightMaskShaderAvailable = m_lightMaskShader.loadFromMemory(lightMaskShaderSource, sf::Shader::Fragment);
+
+			if(m_lightMaskShaderAvailable)
+				m_lightMaskShader.setParameter("mask", sf::Shader::CurrentTexture);
+		}
+
+		m_pWin->setActive();
+	}
+
+	void LightSystem::CreateRenderTextures()
+	{
 		// Base RT size off of window resolution
-		sf::Vector2u viewSizeui(m_pWin->getSize());
+		sf::Vector2u windowSize(m_pWin->getSize());
 
-		m_compositionTexture.create(viewSizeui.x, viewSizeui.y, false);
+		const unsigned int width = std::max(static_cast<unsigned int>(windowSize.x * m_lightingScale), 1u);
+		const unsigned int height = std::max(static_cast<unsigned int>(windowSize.y * m_lightingScale), 1u);
+
+		if(m_distanceFieldCreated)
+			m_distanceField.SetViewSize(Vec2f(static_cast<float>(width), static_cast<float>(height)));
+
+		m_compositionTexture.create(width, height, false);
+
+		// Smooth, so a lower resolution is upsampled bilinearly
 		m_compositionTexture.setSmooth(true);
 
 		m_compositionTexture.setActive();
 		glEnable(GL_BLEND);
 		glEnable(GL_TEXTURE_2D);
 
-		m_bloomTexture.create(viewSizeui.x, viewSizeui.y, false);
-		m_bloomTexture.setSmooth(true);
+		// Timer queries are not shared between contexts, so they go with the context of the composition texture
+		if(m_extensionsLoaded)
+			m_gpuTimer.Create();
 
-		m_bloomTexture.setActive();
-		glEnable(GL_BLEND);
-		glEnable(GL_TEXTURE_2D);
+		// The old stencil buffer belonged to the old frame buffer
+		if(m_compositionStencilBuffer != 0)
+		{
+			glDeleteRenderbuffersEXT(1, &m_compositionStencilBuffer);
+			m_compositionStencilBuffer = 0;
+		}
+
+		CreateCompositionStencil();
 
-		m_lightTempTexture.create(viewSizeui.x, viewSizeui.y, false);
+		if(m_bloomCreated)
+			CreateBloomTextures(width, height);
+
+		m_lightTempTexture.create(width, height, false);
 		m_lightTempTexture.setSmooth(true);
 
 		m_lightTempTexture.setActive();
 		glEnable(GL_BLEND);
 		glEnable(GL_TEXTURE_2D);
 
-		m_pWin->setActive();
+		// New textures are RGBA8, the format settings are applied again before rendering
+		m_appliedCompositionFormat = format_rgba8;
+		m_appliedLightMaskFormat = format_rgba8;
+
+		m_appliedLightingScale = m_lightingScale;
 	}
 
-	void LightSystem::AddLight(Light* newLight)
+	void LightSystem::CreateBloomTextures(unsigned int width, unsigned int height)
 	{
-		newLight->m_pWin = m_pWin;
-		newLight->m_pLightSystem = this;
-		m_lights.insert(newLight);
-		m_lightTree.Add(newLight);
+		m_bloomTexture.create(width, height, false);
+		m_bloomTexture.setSmooth(true);
+
+		m_bloomTexture.setActive();
+		glEnable(GL_BLEND);
+		glEnable(GL_TEXTURE_2D);
+
+		m_bloomPipeline.Resize(width, height);
+
+		m_appliedBloomFormat = format_rgba8;
 	}
 
-	void LightSystem::AddConvexHull(ConvexHull* newConvexHull)
+	void LightSystem::CreateFeatureResources()
 	{
-		m_convexHulls.insert(newConvexHull);
-		m_hullTree.Add(newConvexHull);
+		const sf::Vector2u size(m_compositionTexture.getSize());
+
+		bool created = false;
+
+		if(m_useDistanceField && !m_distanceFieldCreated)
+		{
+			m_distanceField.Create(m_extensionsLoaded && GLEW_VERSION_1_5);
+			m_distanceField.SetViewSize(Vec2f(static_cast<float>(size.x), static_cast<float>(size.y)));
+
+			m_distanceFieldCreated = true;
+			created = true;
+		}
+
+		if(m_useBloom && !m_bloomCreated)
+		{
+			m_bloomPipeline.Create();
+			CreateBloomTextures(size.x, size.y);
+
+			m_bloomCreated = true;
+			created = true;
+		}
+
+		// Other render textures were activated, so the next switch has to restore the projection
+		if(created)
+			m_currentRenderTexture = cur_lightStatic;
 	}
 
-	void LightSystem::AddEmissiveLight(EmissiveLight* newEmissiveLight)
+	void LightSystem::ApplyLightingScale()
 	{
-		m_emissiveLights.insert(newEmissiveLight);
-		m_emissiveTree.Add(newEmissiveLight);
+		if(m_lightingScale == m_appliedLightingScale)
+			return;
+
+		CreateRenderTextures();
+
+		// Other render textures were activated, so the next switch has to restore the projection
+		m_currentRenderTexture = cur_lightStatic;
 	}
 
-	void LightSystem::RemoveLight(Light* pLight)
+	void LightSystem::ApplyTextureFormats()
 	{
-		std::unordered_set<Light*>::iterator it = m_lights.find(pLight);
+		bool changed = false;
 
-		assert(it != m_lights.end());
+		if(m_compositionFormat != m_appliedCompositionFormat)
+		{
+			SetRenderTextureFormat(m_compositionTexture, m_compositionFormat);
 
-		(*it)->RemoveFromTree();
+			m_appliedCompositionFormat = m_compositionFormat;
+			changed = true;
+		}
 
-		m_lights.erase(it);
+		if(m_bloomCreated && m_bloomFormat != m_appliedBloomFormat)
+		{
+			SetRenderTextureFormat(m_bloomTexture, m_bloomFormat);
+			m_bloomPipeline.SetFormat(m_bloomFormat);
 
-		delete pLight;
-	}
+			m_appliedBloomFormat = m_bloomFormat;
+			changed = true;
+		}
 
-	void LightSystem::RemoveConvexHull(ConvexHull* pHull)
-	{
-		std::unordered_set<ConvexHull*>::iterator it = m_convexHulls.find(pHull);
+		if(m_lightMaskFormat != m_appliedLightMaskFormat)
+		{
+			// Single channel textures only work if they are tinted
+			SetRenderTextureFormat(m_lightTempTexture, m_lightMaskShaderAvailable ? m_lightMaskFormat : format_rgba8);
 
-		assert(it != m_convexHulls.end());
+			// The cached lights are lost with the old pages
+			if(m_staticLightAtlas.SetFormat(m_lightMaskFormat))
+				for(std::unordered_set<Light*>::iterator it = m_lights.begin(); it != m_lights.end(); it++)
+				{
+					(*it)->m_staticRegion = StaticLightAtlas::Region();
+					(*it)->m_updateRequired = true;
+				}
 
-		(*it)->RemoveFromTree();
+			m_appliedLightMaskFormat = m_lightMaskFormat;
+			changed = true;
+		}
 
-		m_convexHulls.erase(it);
+		// Other render textures were activated, so the next switch has to restore the projection
+		if(changed)
+			m_currentRenderTexture = cur_lightStatic;
+	}
 
-		delete pHull;
+	float LightSystem::GetStaticLightScale() const
+	{
+		// Power of two levels, so zooming out only rebuilds the cached lights when it crosses a level.
+		// Never above one texel per unit, which bounds the atlas memory when zooming in
+		float scale = 1.0f;
+
+		while(scale > 0.125f && scale * 0.5f >= m_pixelScale)
+			scale *= 0.5f;
+
+		return scale;
 	}
 
-	void LightSystem::RemoveEmissiveLight(EmissiveLight* pEmissiveLight)
+	void LightSystem::SetLightDetail(Light* pLight, float screenRadius)
 	{
-		std::unordered_set<EmissiveLight*>::iterator it = m_emissiveLights.find(pEmissiveLight);
+		const float fullDetailRadius = 256.0f;
 
-		assert(it != m_emissiveLights.end());
+		float detail = 1.0f;
 
-		(*it)->RemoveFromTree();
+		if(m_useLightLOD)
+			detail = std::min(screenRadius * m_lightQuality / fullDetailRadius, 1.0f);
 
-		m_emissiveLights.erase(it);
+		pLight->m_detail = detail;
 
-		delete pEmissiveLight;
+		m_hardShadowsCurrentLight = detail < 0.125f;
+
+		// Extra fins fade out with the detail, the first fin of each side stays until the shadows turn hard
+		m_maxFinsCurrentLight = m_hardShadowsCurrentLight ? 0 : static_cast<unsigned int>(m_maxFins * detail + 0.5f);
 	}
 
-	void LightSystem::ClearLights()
+	bool LightSystem::StaticRebuildBudgetLeft()
 	{
-		// Delete contents
-		for(std::unordered_set<Light*>::iterator it = m_lights.begin(); it != m_lights.end(); it++)
-			delete *it;
+		// At least one per frame, so the rebuilds always make progress
+		if(m_numStaticRebuilds == 0)
+			return true;
 
-		m_lights.clear();
+		if(m_maxStaticRebuilds != 0 && m_numStaticRebuilds >= m_maxStaticRebuilds)
+			return false;
 
-		if(m_lightTree.Created())
-		{
-			m_lightTree.Clear();
-			m_lightTree.Create(AABB(Vec2f(-50.0f, -50.0f), Vec2f(-50.0f, -50.0f)));
-		}
+		// The clock starts with the first rebuild of the frame
+		return m_staticRebuildTime == 0.0f || m_staticRebuildClock.getElapsedTime().asSeconds() * 1000.0f < m_staticRebuildTime;
 	}
 
-	void LightSystem::ClearConvexHulls()
+	void LightSystem::InvalidateCachedLights(const AABB &region, float hullDrift)
 	{
-		// Delete contents
-		for(std::unordered_set<ConvexHull*>::iterator it = m_convexHulls.begin(); it != m_convexHulls.end(); it++)
-			delete *it;
+		if(!m_lightTree.Created())
+			return;
 
-		m_convexHulls.clear();
+		std::vector<qdt::QuadTreeOccupant*> lights;
+		m_lightTree.Query_Region(region, lights);
 
-		if(!m_hullTree.Created())
+		for(unsigned int i = 0, numLights = lights.size(); i < numLights; i++)
 		{
-			m_hullTree.Clear();
-			m_hullTree.Create(AABB(Vec2f(-50.0f, -50.0f), Vec2f(-50.0f, -50.0f)));
+			Light* pLight = static_cast<Light*>(lights[i]);
+
+			if(!pLight->AlwaysUpdate())
+				pLight->m_updateRequired = true;
+			else if(pLight->m_staticRegion.m_page != -1)
+				pLight->m_hullDrift = std::min(pLight->m_hullDrift + hullDrift, std::numeric_limits<float>::max());
 		}
 	}
 
-	void LightSystem::ClearEmissiveLights()
+	bool LightSystem::IsSlowLight(Light* pLight)
 	{
-		// Delete contents
-		for(std::unordered_set<EmissiveLight*>::iterator it = m_emissiveLights.begin(); it != m_emissiveLights.end(); it++)
-			delete *it;
+		return pLight->AlwaysUpdate() && m_dynamicUpdateThreshold > 0.0f &&
+			(pLight->m_center - pLight->m_previousCenter).Magnitude() * m_pixelScale <= m_dynamicUpdateThreshold;
+	}
 
-		m_emissiveLights.clear();
+	float LightSystem::GetCachedLightError(Light* pLight)
+	{
+		const float drift = (pLight->m_center - pLight->m_cachedCenter).Magnitude() + std::abs(pLight->m_radius - pLight->m_cachedRadius) + pLight->m_hullDrift;
 
-		if(m_emissiveTree.Created())
-		{
-			m_emissiveTree.Clear();
-			m_emissiveTree.Create(AABB(Vec2f(-50.0f, -50.0f), Vec2f(-50.0f, -50.0f)));
-		}
+		return drift * m_pixelScale;
 	}
 
-	void LightSystem::SwitchLightTemp()
+	void LightSystem::InvalidateChangedHulls()
 	{
-		if(m_currentRenderTexture != cur_lightTemp)
+		for(std::unordered_set<ConvexHull*>::iterator it = m_convexHulls.begin(); it != m_convexHulls.end(); it++)
 		{
-			m_lightTempTexture.setActive();
+			ConvexHull* pHull = *it;
 
-			//if(currentRenderTexture == cur_lightStatic)
-				SwitchWindowProjection();
+			if(pHull->m_generation == pHull->m_lightGeneration)
+				continue;
 
-			m_currentRenderTexture = cur_lightTemp;
+			// How far it moved or grew. Changes that keep the bounds, such as the transparency, always invalidate
+			const AABB &hullAABB = pHull->GetAABB();
+
+			float hullDrift = (hullAABB.m_lowerBound - pHull->m_lightAABB.m_lowerBound).Magnitude() + (hullAABB.m_upperBound - pHull->m_lightAABB.m_upperBound).Magnitude();
+
+			if(hullDrift == 0.0f)
+				hullDrift = std::numeric_limits<float>::max();
+
+			// The lights the hull left, and the lights it entered
+			InvalidateCachedLights(pHull->m_lightAABB, hullDrift);
+			InvalidateCachedLights(hullAABB, hullDrift);
+
+			pHull->m_lightGeneration = pHull->m_generation;
+			pHull->m_lightAABB = pHull->GetAABB();
+		}
+	}
+
+	bool LightSystem::AllocateStaticRegion(Light* pLight, float scale, bool evict)
+	{
+		Vec2f dims(pLight->m_aabb.GetDims() * scale);
+
+		const unsigned int width = std::max(static_cast<unsigned int>(std::ceil(dims.x)), 1u);
+		const unsigned int height = std::max(static_cast<unsigned int>(std::ceil(dims.y)), 1u);
+
+		// The region is free, so it can take the scale before it is allocated
+		pLight->m_staticRegion.m_scale = scale;
+
+		// Built this frame, so it is not evicted for another light of this frame
+		pLight->m_staticFrame = m_frame;
+
+		if(m_staticLightAtlas.Allocate(width, height, pLight->m_staticRegion, false))
+			return true;
+
+		if(m_staticTextureBudget == 0 || m_staticLightAtlas.GetMemoryUsage() + m_staticLightAtlas.GetNewPageMemory(width, height) <= m_staticTextureBudget)
+			return m_staticLightAtlas.Allocate(width, height, pLight->m_staticRegion);
+
+		if(!evict)
+			return false;
+
+		// Cached lights that were not composited this frame, least recently composited first
+		std::vector<std::pair<unsigned int, Light*>> evictable;
+
+		for(std::unordered_set<Light*>::iterator it = m_lights.begin(); it != m_lights.end(); it++)
+			if((*it)->m_staticRegion.m_page != -1 && (*it)->m_staticFrame != m_frame)
+				evictable.push_back(std::pair<unsigned int, Light*>((*it)->m_staticFrame, *it));
+
+		std::sort(evictable.begin(), evictable.end());
+
+		for(unsigned int i = 0, numEvictable = evictable.size(); i < numEvictable; i++)
+		{
+			// Rebuilt when it becomes visible again
+			Light* pEvicted = evictable[i].second;
+
+			m_staticLightAtlas.Free(pEvicted->m_staticRegion);
+			pEvicted->m_updateRequired = true;
+
+			if(m_staticLightAtlas.Allocate(width, height, pLight->m_staticRegion, false))
+				return true;
+
+			// Freeing may have released a whole page
+			if(m_staticLightAtlas.GetMemoryUsage() + m_staticLightAtlas.GetNewPageMemory(width, height) <= m_staticTextureBudget)
+				return m_staticLightAtlas.Allocate(width, height, pLight->m_staticRegion);
+		}
+
+		return false;
+	}
+
+	void LightSystem::CreateCompositionStencil()
+	{
+		m_stencilAvailable = false;
+
+		if(!m_extensionsLoaded || !GLEW_EXT_framebuffer_object || !GLEW_EXT_packed_depth_stencil || !sf::Shader::isAvailable())
+			return;
+
+		// SFML render textures only come with a depth buffer, so attach a stencil buffer to the frame buffer of the active render texture
+		GLint frameBuffer = 0;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT, &frameBuffer);
+
+		if(frameBuffer == 0)
+			return;
+
+		sf::Vector2u size(m_compositionTexture.getSize());
+
+		glGenRenderbuffersEXT(1, &m_compositionStencilBuffer);
+		glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, m_compositionStencilBuffer);
+		glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_DEPTH24_STENCIL8_EXT, size.x, size.y);
+		glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, 0);
+
+		glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_STENCIL_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, m_compositionStencilBuffer);
+
+		if(glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) != GL_FRAMEBUFFER_COMPLETE_EXT)
+		{
+			glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_STENCIL_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, 0);
+			glDeleteRenderbuffersEXT(1, &m_compositionStencilBuffer);
+			m_compositionStencilBuffer = 0;
+
+			return;
+		}
+
+		// Attenuation times the light that gets through the fin
+		const std::string finStencilShaderSource =
+			"uniform vec2 lightPos;\n"
+			"uniform vec3 lightColor;\n"
+			"uniform float radius;\n"
+			"uniform float bleed;\n"
+			"uniform float linearizeFactor;\n"
+			"uniform sampler2D finTexture;\n"
+			"uniform float inverseFin;\n" +
+			LightQuads::GetAttenuationSource() +
+			"void main()\n"
+			"{\n"
+			"	float attenuation = Attenuation(length(lightPos - gl_FragCoord.xy), radius, bleed, linearizeFactor);\n"
+			"	float fin = gl_Color.a * texture2D(finTexture, gl_TexCoord[0].xy).a;\n"
+			"	gl_FragColor = vec4(lightColor * attenuation * mix(fin, 1.0 - fin, inverseFin), 1.0);\n"
+			"}\n";
+
+		if(!m_finStencilShader.loadFromMemory(finStencilShaderSource, sf::Shader::Fragment))
+			return;
+
+		m_stencilAvailable = true;
+	}
+
+	void LightSystem::RenderLightStencil(Light* pLight, const std::vector<qdt::QuadTreeOccupant*> &shadowHulls, const std::vector<qdt::QuadTreeOccupant*> &regionHulls,
+		const AABB &lightScreenRegion, const ClipRegion* pClipRegion, bool useVisibilityPolygon)
+	{
+		MaskShadows(pLight, shadowHulls, pClipRegion, useVisibilityPolygon);
+
+		// Hulls that are not lit mask off their interior as well
+		for(unsigned int h = 0, numHulls = regionHulls.size(); h < numHulls; h++)
+		{
+			ConvexHull* pHull = static_cast<ConvexHull*>(regionHulls[h]);
+
+			if(pHull->m_renderLightOverHull)
+				continue;
+
+			std::vector<Vec2f> &hullVertices = m_umbraStrip;
+			hullVertices.clear();
+
+			for(unsigned int v = 0, numVertices = pHull->m_vertices.size(); v < numVertices; v++)
+				hullVertices.push_back(pHull->GetWorldVertex(v));
+
+			m_shadowBatch.AddPolygon(ShadowBatch::blend_umbra, hullVertices, Vec2f(1.0f, 1.0f), 2.0f, 0.0f);
+		}
+
+		SwitchComposition();
+		CameraSetup();
+
+		// The stencil only has to be cleared where the light is
+		glEnable(GL_SCISSOR_TEST);
+		ScissorScreenRegion(lightScreenRegion);
+
+		glClearStencil(0);
+		glClear(GL_STENCIL_BUFFER_BIT);
+
+		glEnable(GL_STENCIL_TEST);
+
+		m_shadowBatch.Upload();
+
+		// Umbras only mark the stencil buffer
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDisable(GL_TEXTURE_2D);
+
+		glStencilFunc(GL_ALWAYS, 1, 1);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+		m_shadowBatch.Draw(ShadowBatch::blend_umbra, ShadowBatch::blend_umbra);
+
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glEnable(GL_TEXTURE_2D);
+
+		glBlendFunc(GL_ONE, GL_ONE);
+
+		// The shaders work on composition pixels
+		const Vec2f lightPos((pLight->m_center - m_viewAABB.m_lowerBound) * m_pixelScale);
+
+		const Color3f lightTint(GetLightTint(pLight));
+
+		// Fins add the light that gets through them, and mark their pixels so that overlapping fins and the light itself do not add it again
+		glStencilFunc(GL_EQUAL, 0, 1);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT);
+
+		if(!m_shadowBatch.Empty(ShadowBatch::blend_multiply) || !m_shadowBatch.Empty(ShadowBatch::blend_multiplyInverse))
+		{
+			m_finStencilShader.setParameter("lightPos", lightPos.x, lightPos.y);
+			m_finStencilShader.setParameter("lightColor", lightTint.r, lightTint.g, lightTint.b);
+			m_finStencilShader.setParameter("radius", pLight->m_radius * m_pixelScale);
+			m_finStencilShader.setParameter("bleed", pLight->m_bleed * m_pixelScale);
+			m_finStencilShader.setParameter("linearizeFactor", pLight->m_linearizeFactor);
+			m_finStencilShader.setParameter("finTexture", m_softShadowTexture);
+
+			sf::Shader::bind(&m_finStencilShader);
+
+			m_finStencilShader.setParameter("inverseFin", 0.0f);
+			m_shadowBatch.Draw(ShadowBatch::blend_multiply, ShadowBatch::blend_multiply);
+
+			m_finStencilShader.setParameter("inverseFin", 1.0f);
+			m_shadowBatch.Draw(ShadowBatch::blend_multiplyInverse, ShadowBatch::blend_multiplyInverse);
+
+			sf::Shader::bind(NULL);
+		}
+
+		m_shadowBatch.Finish();
+
+		// The light itself where nothing was marked
+		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+		glDisable(GL_TEXTURE_2D);
+
+		sf::Shader::bind(&m_lightAttenuationShader);
+
+		m_lightAttenuationShader.setParameter("lightPos", lightPos.x, lightPos.y);
+		m_lightAttenuationShader.setParameter("lightColor", lightTint.r, lightTint.g, lightTint.b);
+		m_lightAttenuationShader.setParameter("radius", pLight->m_radius * m_pixelScale);
+		m_lightAttenuationShader.setParameter("bleed", pLight->m_bleed * m_pixelScale);
+		m_lightAttenuationShader.setParameter("linearizeFactor", pLight->m_linearizeFactor);
+
+		if(useVisibilityPolygon)
+			m_visibilityPolygon.Render();
+		else
+			pLight->RenderLightSolidPortion();
+
+		sf::Shader::bind(NULL);
+
+		glDisable(GL_STENCIL_TEST);
+		glDisable(GL_SCISSOR_TEST);
+
+		glEnable(GL_TEXTURE_2D);
+
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	bool LightSystem::CanSkipLightTemp(Light* pLight)
+	{
+		// The soft portion needs the light in its own texture
+		return pLight->AlwaysUpdate() && pLight->m_shaderAttenuation && !pLight->HasSoftPortion();
+	}
+
+	bool LightSystem::CastsTranslucentShadow(Light* pLight, const std::vector<qdt::QuadTreeOccupant*> &regionHulls)
+	{
+		for(unsigned int h = 0, numHulls = regionHulls.size(); h < numHulls; h++)
+		{
+			ConvexHull* pHull = static_cast<ConvexHull*>(regionHulls[h]);
+
+			if(pHull->m_transparency != 1.0f && CastsShadow(pLight, pHull))
+				return true;
+		}
+
+		return false;
+	}
+
+	Color3f LightSystem::GetLightTint(Light* pLight)
+	{
+		const float tintIntensity = std::min(pLight->m_intensity, 1.0f);
+
+		return Color3f(pLight->m_color.r * tintIntensity, pLight->m_color.g * tintIntensity, pLight->m_color.b * tintIntensity);
+	}
+
+	Color3f LightSystem::GetBloomTint(Light* pLight)
+	{
+		if(!m_useBloom || pLight->m_intensity <= 1.0f)
+			return Color3f(0.0f, 0.0f, 0.0f);
+
+		const float excess = pLight->m_intensity - 1.0f;
+
+		return Color3f(pLight->m_color.r * excess, pLight->m_color.g * excess, pLight->m_color.b * excess);
+	}
+
+	void LightSystem::AddLight(Light* newLight)
+	{
+		newLight->m_pWin = m_pWin;
+		newLight->m_pLightSystem = this;
+		m_lights.insert(newLight);
+		m_lightTree.Add(newLight);
+	}
+
+	void LightSystem::AddConvexHull(ConvexHull* newConvexHull)
+	{
+		m_convexHulls.insert(newConvexHull);
+		m_hullTree.Add(newConvexHull);
+
+		m_hullEdgeBuffer.Invalidate();
+
+		InvalidateCachedLights(newConvexHull->GetAABB());
+
+		newConvexHull->m_lightGeneration = newConvexHull->m_generation;
+		newConvexHull->m_lightAABB = newConvexHull->GetAABB();
+	}
+
+	void LightSystem::AddEmissiveLight(EmissiveLight* newEmissiveLight)
+	{
+		m_emissiveLights.insert(newEmissiveLight);
+		m_emissiveTree.Add(newEmissiveLight);
+	}
+
+	void LightSystem::RemoveLight(Light* pLight)
+	{
+		std::unordered_set<Light*>::iterator it = m_lights.find(pLight);
+
+		assert(it != m_lights.end());
+
+		(*it)->RemoveFromTree();
+
+		m_lights.erase(it);
+
+		m_staticLightAtlas.Free(pLight->m_staticRegion);
+
+		std::vector<Light*>::iterator queued = std::find(m_lightsToPreBuild.begin(), m_lightsToPreBuild.end(), pLight);
+
+		if(queued != m_lightsToPreBuild.end())
+			m_lightsToPreBuild.erase(queued);
+
+		delete pLight;
+	}
+
+	void LightSystem::RemoveConvexHull(ConvexHull* pHull)
+	{
+		std::unordered_set<ConvexHull*>::iterator it = m_convexHulls.find(pHull);
+
+		assert(it != m_convexHulls.end());
+
+		(*it)->RemoveFromTree();
+
+		m_convexHulls.erase(it);
+
+		m_hullEdgeBuffer.Invalidate();
+
+		// It may have moved since the last frame
+		InvalidateCachedLights(pHull->m_lightAABB);
+		InvalidateCachedLights(pHull->GetAABB());
+
+		delete pHull;
+	}
+
+	void LightSystem::RemoveEmissiveLight(EmissiveLight* pEmissiveLight)
+	{
+		std::unordered_set<EmissiveLight*>::iterator it = m_emissiveLights.find(pEmissiveLight);
+
+		assert(it != m_emissiveLights.end());
+
+		(*it)->RemoveFromTree();
+
+		m_emissiveLights.erase(it);
+
+		delete pEmissiveLight;
+	}
+
+	void LightSystem::ClearLights()
+	{
+		// Delete contents
+		for(std::unordered_set<Light*>::iterator it = m_lights.begin(); it != m_lights.end(); it++)
+			delete *it;
+
+		m_lights.clear();
+		m_lightsToPreBuild.clear();
+
+		m_staticLightAtlas.Clear();
+
+		if(m_lightTree.Created())
+		{
+			m_lightTree.Clear();
+			m_lightTree.Create(AABB(Vec2f(-50.0f, -50.0f), Vec2f(-50.0f, -50.0f)));
+		}
+	}
+
+	void LightSystem::ClearConvexHulls()
+	{
+		// Delete contents
+		for(std::unordered_set<ConvexHull*>::iterator it = m_convexHulls.begin(); it != m_convexHulls.end(); it++)
+		{
+			InvalidateCachedLights((*it)->m_lightAABB);
+			InvalidateCachedLights((*it)->GetAABB());
+
+			delete *it;
+		}
+
+		m_convexHulls.clear();
+
+		m_hullEdgeBuffer.Invalidate();
+
+		if(!m_hullTree.Created())
+		{
+			m_hullTree.Clear();
+			m_hullTree.Create(AABB(Vec2f(-50.0f, -50.0f), Vec2f(-50.0f, -50.0f)));
+		}
+	}
+
+	void LightSystem::ClearEmissiveLights()
+	{
+		// Delete contents
+		for(std::unordered_set<EmissiveLight*>::iterator it = m_emissiveLights.begin(); it != m_emissiveLights.end(); it++)
+			delete *it;
+
+		m_emissiveLights.clear();
+
+		if(m_emissiveTree.Created())
+		{
+			m_emissiveTree.Clear();
+			m_emissiveTree.Create(AABB(Vec2f(-50.0f, -50.0f), Vec2f(-50.0f, -50.0f)));
+		}
+	}
+
+	void LightSystem::RefreshEmissiveTextures()
+	{
+		m_emissiveBatch.ClearAtlas();
+
+		// Clearing activated the atlas, so the next switch has to restore the projection
+		m_currentRenderTexture = cur_lightStatic;
+	}
+
+	void LightSystem::SwitchLightTemp()
+	{
+		if(m_currentRenderTexture != cur_lightTemp)
+		{
+			m_lightTempTexture.setActive();
+
+			//if(currentRenderTexture == cur_lightStatic)
+				SwitchWindowProjection();
+
+			m_currentRenderTexture = cur_lightTemp;
 		}
 	}
 
@@ -529,49 +1328,156 @@ namespace ltbl
 	void LightSystem::SwitchWindowProjection()
 	{
 		Vec2f viewSize(m_viewAABB.GetDims());
-		sf::Vector2u viewSizeui(static_cast<unsigned int>(viewSize.x), static_cast<unsigned int>(viewSize.y));
 
-		glViewport(0, 0, viewSizeui.x, viewSizeui.y);
+		// The lighting textures can have a different resolution than the view, the projection stays in view units
+		sf::Vector2u targetSize(m_compositionTexture.getSize());
+
+		glViewport(0, 0, targetSize.x, targetSize.y);
 
 		glMatrixMode(GL_PROJECTION);
 		glLoadIdentity();
 
-		// Upside-down, because SFML is pro like that
-		glOrtho(0, viewSize.x, 0, viewSize.y, -100.0f, 100.0f);
-		glMatrixMode(GL_MODELVIEW);
-	}
+		// Upside-down, because SFML is pro like that
+		glOrtho(0, viewSize.x, 0, viewSize.y, -100.0f, 100.0f);
+		glMatrixMode(GL_MODELVIEW);
+	}
+
+	void LightSystem::ClearLightTexture(sf::RenderTexture &renTex)
+	{	
+		glLoadIdentity();
+				
+		renTex.clear(sf::Color::Transparent);
+
+		// Clear with quad, since glClear is not working for some reason... if results in very ugly artifacts. MUST clear with full color, with alpha!
+		glColor4f(0.0f, 0.0f, 0.0f, 0.0f);
+
+		// The projection is in view units
+		Vec2f viewSize(m_viewAABB.GetDims());
+		float width = viewSize.x;
+		float height = viewSize.y;
+
+		glBlendFunc(GL_ONE, GL_ZERO);
+
+		glBegin(GL_QUADS);
+			glVertex2f(0.0f, 0.0f);
+			glVertex2f(width, 0.0f);
+			glVertex2f(width, height);
+			glVertex2f(0.0f, height);
+		glEnd();
+	}
+
+	AABB LightSystem::GetLightScreenRegion(Light* pLight)
+	{
+		Vec2f viewSize(m_viewAABB.GetDims());
+
+		const AABB &lightAABB = *pLight->GetAABB();
+
+		// Whole pixels, so the scissor rectangle covers everything the light touches
+		Vec2f lowerBound(std::floor(lightAABB.m_lowerBound.x - m_viewAABB.m_lowerBound.x), std::floor(lightAABB.m_lowerBound.y - m_viewAABB.m_lowerBound.y));
+		Vec2f upperBound(std::ceil(lightAABB.m_upperBound.x - m_viewAABB.m_lowerBound.x), std::ceil(lightAABB.m_upperBound.y - m_viewAABB.m_lowerBound.y));
+
+		lowerBound.x = std::min(std::max(lowerBound.x, 0.0f), viewSize.x);
+		lowerBound.y = std::min(std::max(lowerBound.y, 0.0f), viewSize.y);
+		upperBound.x = std::min(std::max(upperBound.x, lowerBound.x), viewSize.x);
+		upperBound.y = std::min(std::max(upperBound.y, lowerBound.y), viewSize.y);
+
+		return AABB(lowerBound, upperBound);
+	}
+
+	void LightSystem::ScissorScreenRegion(const AABB &screenRegion)
+	{
+		// Whole render texture pixels, so the rectangle still covers the region at a lower lighting resolution
+		const int lowerX = static_cast<int>(std::floor(screenRegion.m_lowerBound.x * m_pixelScale));
+		const int lowerY = static_cast<int>(std::floor(screenRegion.m_lowerBound.y * m_pixelScale));
+		const int upperX = static_cast<int>(std::ceil(screenRegion.m_upperBound.x * m_pixelScale));
+		const int upperY = static_cast<int>(std::ceil(screenRegion.m_upperBound.y * m_pixelScale));
+
+		glScissor(lowerX, lowerY, upperX - lowerX, upperY - lowerY);
+	}
+
+	void LightSystem::RenderLightTempRegion(const AABB &screenRegion)
+	{
+		Vec2f viewSize(m_viewAABB.GetDims());
+
+		const Vec2f &lower = screenRegion.m_lowerBound;
+		const Vec2f &upper = screenRegion.m_upperBound;
+
+		// Texture is upside-down for some reason, so draw flipped
+		glBegin(GL_QUADS);
+			glTexCoord2f(lower.x / viewSize.x, 1.0f - lower.y / viewSize.y); glVertex2f(lower.x, lower.y);
+			glTexCoord2f(upper.x / viewSize.x, 1.0f - lower.y / viewSize.y); glVertex2f(upper.x, lower.y);
+			glTexCoord2f(upper.x / viewSize.x, 1.0f - upper.y / viewSize.y); glVertex2f(upper.x, upper.y);
+			glTexCoord2f(lower.x / viewSize.x, 1.0f - upper.y / viewSize.y); glVertex2f(lower.x, upper.y);
+		glEnd();
+	}
+
+	void LightSystem::RenderLights()
+	{
+		m_lightingClock.restart();
+
+		if(m_useGovernor)
+		{
+			const QualityGovernor::Settings &settings = m_governor.GetSettings();
+
+			m_lightingScale = settings.m_lightingScale;
+			m_maxFins = settings.m_maxFins;
+			m_lightQuality = settings.m_lightQuality;
+			m_useBloom = settings.m_useBloom;
+			m_dynamicUpdateThreshold = settings.m_dynamicUpdateThreshold;
+		}
+
+		m_frame++;
+
+		ApplyLightingScale();
+		CreateFeatureResources();
+		ApplyTextureFormats();
+
+		// The lighting is rendered on the contexts of the render textures, not the window context.
+		// The queries are issued from the composition texture, after it may have been recreated
+		m_compositionTexture.setActive();
+		m_gpuTimer.Begin();
+
+		InvalidateChangedHulls();
+
+		Vec2f viewCenter(m_viewAABB.GetCenter());
+		Vec2f viewSize(m_viewAABB.GetDims());
+
+		// Shaders and scissor rectangles work on render texture pixels, geometry on view units
+		m_pixelScale = viewSize.x > 0.0f ? m_compositionTexture.getSize().x / viewSize.x : 1.0f;
+
+		if(m_extrudeShadows && m_hullEdgeBuffer.Available())
+			m_hullEdgeBuffer.Update(m_convexHulls);
+
+		// Get visible lights
+		std::vector<qdt::QuadTreeOccupant*> visibleLights;
+		m_lightTree.Query_Region(m_viewAABB, visibleLights);
+
+		const unsigned int numVisibleLights = visibleLights.size();
+
+		if(m_useDistanceField && m_distanceField.Available())
+		{
+			// Lights march up to their radius from the pixels in view, so the field has to reach as far beyond the view
+			float padding = 0.0f;
 
-	void LightSystem::ClearLightTexture(sf::RenderTexture &renTex)
-	{	
-		glLoadIdentity();
-				
-		renTex.clear(sf::Color::Transparent);
+			for(unsigned int l = 0; l < numVisibleLights; l++)
+			{
+				Light* pLight = static_cast<Light*>(visibleLights[l]);
 
-		// Clear with quad, since glClear is not working for some reason... if results in very ugly artifacts. MUST clear with full color, with alpha!
-		glColor4f(0.0f, 0.0f, 0.0f, 0.0f);
+				if(CanSkipLightTemp(pLight))
+					padding = std::max(padding, pLight->m_radius);
+			}
 
-		sf::Vector2u size(renTex.getSize());
-		float width = static_cast<float>(size.x);
-		float height = static_cast<float>(size.y);
+			m_distanceField.SetView(m_viewAABB, padding);
 
-		glBlendFunc(GL_ONE, GL_ZERO);
+			std::vector<qdt::QuadTreeOccupant*> hullsInRegion;
+			m_hullTree.Query_Region(m_distanceField.GetRegion(), hullsInRegion);
 
-		glBegin(GL_QUADS);
-			glVertex2f(0.0f, 0.0f);
-			glVertex2f(width, 0.0f);
-			glVertex2f(width, height);
-			glVertex2f(0.0f, height);
-		glEnd();
-	}
+			m_distanceField.Update(hullsInRegion);
+		}
 
-	void LightSystem::RenderLights()
-	{
 		// So will switch to main render textures from SFML projection
 		m_currentRenderTexture = cur_lightStatic;
 
-		Vec2f viewCenter(m_viewAABB.GetCenter());
-		Vec2f viewSize(m_viewAABB.GetDims());
-
 		glDisable(GL_TEXTURE_2D);
 
 		if(m_useBloom)
@@ -620,34 +1526,76 @@ namespace ltbl
 
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		// Get visible lights
-		std::vector<qdt::QuadTreeOccupant*> visibleLights;
-		m_lightTree.Query_Region(m_viewAABB, visibleLights);
+		if(m_tileFreeLights)
+			m_tiledLightGrid.Begin(viewSize * m_pixelScale);
 
-		// Add lights from pre build list if there are any
-		if(!m_lightsToPreBuild.empty())
+		// Nearest to the view center first, so those get the static light rebuilds when the budget runs out
+		std::vector<std::pair<float, Light*>> lightOrder;
+
+		// Cached dynamic lights that drifted too far, least recently rendered first
+		std::vector<std::pair<unsigned int, Light*>> driftedLights;
+
+		for(unsigned int l = 0; l < numVisibleLights; l++)
 		{
-			if(m_prebuildTimer < 2)
-			{
-				m_prebuildTimer++;
+			Light* pLight = static_cast<Light*>(visibleLights[l]);
+
+			// Visible cached lights are in use this frame, so none of them is evicted to make space for another
+			if(!pLight->AlwaysUpdate() || pLight->m_staticRegion.m_page != -1)
+				pLight->m_staticFrame = m_frame;
 
-				const unsigned int numLightsToPreBuild = m_lightsToPreBuild.size();
+			if(pLight->AlwaysUpdate())
+			{
+				pLight->m_amortized = false;
 
-				for(unsigned int i = 0; i < numLightsToPreBuild; i++)
+				if(pLight->m_staticRegion.m_page != -1)
 				{
-					m_lightsToPreBuild[i]->m_updateRequired = true;
-					visibleLights.push_back(m_lightsToPreBuild[i]);
+					pLight->m_updateRequired = false;
+
+					if(IsSlowLight(pLight) && GetCachedLightError(pLight) > m_dynamicUpdateThreshold)
+						driftedLights.push_back(std::pair<unsigned int, Light*>(pLight->m_cachedFrame, pLight));
 				}
 			}
-			else
-				m_lightsToPreBuild.clear();
+
+			lightOrder.push_back(std::pair<float, Light*>((pLight->m_center - viewCenter).MagnitudeSquared(), pLight));
 		}
 
-		const unsigned int numVisibleLights = visibleLights.size();
+		std::sort(lightOrder.begin(), lightOrder.end());
 
-		for(unsigned int l = 0; l < numVisibleLights; l++)
+		// Round robin over the drifted lights, the others keep their old texture for another frame
+		std::sort(driftedLights.begin(), driftedLights.end());
+
+		for(unsigned int i = 0, numDrifted = driftedLights.size(); i < numDrifted && (m_maxDynamicRebuilds == 0 || i < m_maxDynamicRebuilds); i++)
+			driftedLights[i].second->m_updateRequired = true;
+
+		// Queued static lights out of view come after all visible lights. Those that are cached or turned dynamic leave the queue
+		unsigned int numQueued = 0;
+
+		for(unsigned int i = 0, numLightsToPreBuild = m_lightsToPreBuild.size(); i < numLightsToPreBuild; i++)
 		{
-			Light* pLight = static_cast<Light*>(visibleLights[l]);
+			Light* pLight = m_lightsToPreBuild[i];
+
+			if(pLight->AlwaysUpdate() || (pLight->m_staticRegion.m_page != -1 && !pLight->m_updateRequired))
+				continue;
+
+			m_lightsToPreBuild[numQueued++] = pLight;
+
+			if(pLight->m_staticFrame != m_frame)
+				lightOrder.push_back(std::pair<float, Light*>((pLight->m_center - viewCenter).MagnitudeSquared(), pLight));
+		}
+
+		m_lightsToPreBuild.resize(numQueued);
+
+		std::sort(lightOrder.begin() + numVisibleLights, lightOrder.end());
+
+		const float staticLightScale = GetStaticLightScale();
+
+		m_numStaticRebuilds = 0;
+
+		for(unsigned int l = 0, numLights = lightOrder.size(); l < numLights; l++)
+		{
+			Light* pLight = lightOrder[l].second;
+
+			const bool visible = l < numVisibleLights;
 
 			// Skip invisible lights
 			if(pLight->m_intensity == 0.0f)
@@ -655,7 +1603,33 @@ namespace ltbl
 
 			bool updateRequired = false;
 
-			if(pLight->AlwaysUpdate())
+			// Static lights are cached in the atlas, or rendered like dynamic lights if there is no space for them
+			bool cached = !pLight->AlwaysUpdate();
+
+			// Built only within the budget if there is nothing that has to be shown
+			const bool rebuildDeferrable = cached && (!visible || pLight->m_staticRegion.m_page != -1);
+
+			if(!visible && !StaticRebuildBudgetLeft())
+				continue;
+
+			if(cached && pLight->m_staticRegion.m_page == -1)
+			{
+				if(AllocateStaticRegion(pLight, staticLightScale, visible))
+					pLight->m_updateRequired = true;
+				else if(!visible)
+				{
+					// Built when it comes into view
+					m_lightsToPreBuild.erase(std::find(m_lightsToPreBuild.begin(), m_lightsToPreBuild.end(), pLight));
+
+					continue;
+				}
+				else
+					cached = false;
+			}
+			else if(cached && pLight->m_staticRegion.m_scale != staticLightScale)
+				pLight->m_updateRequired = true; // Cached at another resolution than the zoom asks for, the old one is shown until the rebuild
+
+			if(!cached)
 				updateRequired = true;
 			else if(pLight->m_updateRequired)
 				updateRequired = true;
@@ -666,255 +1640,453 @@ namespace ltbl
 
 			const unsigned int numHulls = regionHulls.size();
 
-			if(!updateRequired)
+			float lowerAngle, upperAngle;
+			pLight->GetAngularRange(lowerAngle, upperAngle);
+
+			// Nothing to mask off, so the light can skip the light temp texture. Batched lights are full disks
+			if(numHulls == 0 && m_batchFreeLights && m_freeLightBatch.Available() && upperAngle - lowerAngle >= pifTimes2 && CanSkipLightTemp(pLight))
+			{
+				if(!m_tileFreeLights ||
+					!m_tiledLightGrid.AddLight((pLight->m_center - m_viewAABB.m_lowerBound) * m_pixelScale, pLight->m_radius * m_pixelScale, GetLightTint(pLight),
+					pLight->m_bleed * m_pixelScale, pLight->m_linearizeFactor))
+					m_freeLightBatch.AddLight(pLight->m_center, pLight->m_radius, GetLightTint(pLight), pLight->m_bleed, pLight->m_linearizeFactor, -m_viewAABB.m_lowerBound, m_pixelScale);
+
+				if(m_useBloom && pLight->m_intensity > 1.0f)
+					m_bloomLightBatch.AddLight(pLight->m_center, pLight->m_radius, GetBloomTint(pLight), pLight->m_bleed, pLight->m_linearizeFactor, -m_viewAABB.m_lowerBound, m_pixelScale);
+
+				continue;
+			}
+
+			// The distance field and the shadow map only know the nearest occluder, so lights behind translucent hulls still use shadow geometry
+			const bool opaqueShadowsOnly = (m_useDistanceField || m_useShadowMaps) && CanSkipLightTemp(pLight) && !CastsTranslucentShadow(pLight, regionHulls);
+
+			if(m_useDistanceField && m_distanceField.Available() && opaqueShadowsOnly)
+			{
+				m_distanceField.AddLight(pLight->m_center, pLight->m_radius, pLight->m_size, GetLightTint(pLight), GetBloomTint(pLight), pLight->m_bleed, pLight->m_linearizeFactor,
+					lowerAngle, upperAngle, -m_viewAABB.m_lowerBound, m_pixelScale);
+
+				continue;
+			}
+
+			if(m_useShadowMaps && m_shadowMap.Available() && !m_shadowMap.Full() && opaqueShadowsOnly)
 			{
-				// See of any of the hulls need updating
+				m_shadowMap.BeginLight(pLight->m_center, pLight->m_radius, pLight->m_size, GetLightTint(pLight), GetBloomTint(pLight), pLight->m_bleed, pLight->m_linearizeFactor,
+					lowerAngle, upperAngle, -m_viewAABB.m_lowerBound, m_pixelScale);
+
 				for(unsigned int h = 0; h < numHulls; h++)
 				{
 					ConvexHull* pHull = static_cast<ConvexHull*>(regionHulls[h]);
 
-					if(pHull->m_updateRequired)
+					if(CastsShadow(pLight, pHull))
+						m_shadowMap.AddHull(*pHull);
+				}
+
+				m_shadowMap.EndLight();
+
+				continue;
+			}
+
+			// Slow dynamic lights are shown from a cached texture like static lights, until they drifted too far
+			if(!cached && visible && IsSlowLight(pLight))
+			{
+				// A rebuild with another radius needs a region of another size
+				if(pLight->m_staticRegion.m_page == -1 || pLight->m_staticRegion.m_scale != staticLightScale ||
+					(pLight->m_updateRequired && pLight->m_radius != pLight->m_cachedRadius))
+				{
+					m_staticLightAtlas.Free(pLight->m_staticRegion);
+
+					if(AllocateStaticRegion(pLight, staticLightScale, true))
+						pLight->m_updateRequired = true;
+				}
+
+				if(pLight->m_staticRegion.m_page != -1)
+				{
+					cached = true;
+					updateRequired = pLight->m_updateRequired;
+
+					pLight->m_amortized = true;
+				}
+			}
+
+			// Static lights that still have their old texture to show are rebuilt within the budget, the others on a later frame
+			if(updateRequired && rebuildDeferrable)
+			{
+				if(!StaticRebuildBudgetLeft())
+				{
+					pLight->m_updateRequired = true;
+					updateRequired = false;
+				}
+				else if(pLight->m_staticRegion.m_scale != staticLightScale)
+				{
+					m_staticLightAtlas.Free(pLight->m_staticRegion);
+
+					if(!AllocateStaticRegion(pLight, staticLightScale, visible))
 					{
-						pHull->m_updateRequired = false;
-						updateRequired = true;
-						break;
+						if(!visible)
+						{
+							// Built when it comes into view
+							m_lightsToPreBuild.erase(std::find(m_lightsToPreBuild.begin(), m_lightsToPreBuild.end(), pLight));
+
+							continue;
+						}
+
+						cached = false;
 					}
 				}
 			}
 
+			if(updateRequired && cached && !pLight->AlwaysUpdate() && m_numStaticRebuilds++ == 0)
+				m_staticRebuildClock.restart();
+
 			if(updateRequired)
 			{
-				Vec2f staticTextureOffset;
+				// Detail from the size of the light in the texture it is rendered to
+				SetLightDetail(pLight, pLight->m_radius * (cached ? pLight->m_staticRegion.m_scale : m_pixelScale));
 
-				// Activate the intermediate render Texture
-				if(pLight->AlwaysUpdate())
-				{
-					SwitchLightTemp();
+				// Part of the view covered by the light, relative to the view
+				AABB lightScreenRegion(Vec2f(0.0f, 0.0f), viewSize);
 
-					ClearLightTexture(m_lightTempTexture);
+				if(!cached && (m_scissorLights || m_useStencilShadows))
+					lightScreenRegion = GetLightScreenRegion(pLight);
 
-					CameraSetup();
+				// Hulls that actually cast a visible shadow
+				std::vector<qdt::QuadTreeOccupant*> shadowHulls;
 
-					// Reset color
-					glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-				}
+				if(m_useOcclusionCulling)
+					CullOccludedHulls(pLight, regionHulls, shadowHulls);
 				else
-				{
-					pLight->SwitchStaticTexture();
-					m_currentRenderTexture = cur_lightStatic;
+					shadowHulls = regionHulls;
 
-					ClearLightTexture(*pLight->m_pStaticTexture);
+				const unsigned int numShadowHulls = shadowHulls.size();
 
-					// Reset color
-					glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+				m_shadowUnion.Clear();
+
+				const ClipRegion* pClipRegion = NULL;
+
+				if(m_clipShadows)
+				{
+					// 16 sides keep the polygon within a few percent of the disk area
+					m_shadowClipRegion.SetCircle(pLight->m_center, pLight->m_radius, 16);
 
-					staticTextureOffset = pLight->m_aabb.GetDims() / 2.0f;
+					if(!cached)
+						m_shadowClipRegion.Intersect(m_viewAABB);
+					else
+						m_shadowClipRegion.Intersect(pLight->m_aabb);
 
-					glTranslatef(-pLight->m_aabb.m_lowerBound.x, -pLight->m_aabb.m_lowerBound.y, 0.0f);
+					pClipRegion = &m_shadowClipRegion;
 				}
 
-				if(pLight->m_shaderAttenuation)
+				// The visibility polygon replaces the light shape, so it needs the attenuation shader for coloring
+				const bool useVisibilityPolygon = m_useVisibilityPolygons && pLight->m_shaderAttenuation;
+
+				if(useVisibilityPolygon)
 				{
-					sf::Shader::bind(&m_lightAttenuationShader);
+					m_visibilityPolygon.Begin(pLight->m_center, pLight->m_radius);
 
-					if(pLight->AlwaysUpdate())
-						m_lightAttenuationShader.setParameter("lightPos", pLight->m_center.x - m_viewAABB.m_lowerBound.x, pLight->m_center.y - m_viewAABB.m_lowerBound.y);
-					else
-						m_lightAttenuationShader.setParameter("lightPos", pLight->m_center.x - pLight->m_aabb.m_lowerBound.x, pLight->m_center.y - pLight->m_aabb.m_lowerBound.y);
+					// Opaque hulls are cut out of the visibility polygon, the rest is masked as usual
+					for(unsigned int h = 0; h < numShadowHulls; h++)
+					{
+						ConvexHull* pHull = static_cast<ConvexHull*>(shadowHulls[h]);
 
-					m_lightAttenuationShader.setParameter("lightColor", pLight->m_color.r, pLight->m_color.g, pLight->m_color.b);
-					m_lightAttenuationShader.setParameter("radius", pLight->m_radius);
-					m_lightAttenuationShader.setParameter("bleed", pLight->m_bleed);
-					m_lightAttenuationShader.setParameter("linearizeFactor", pLight->m_linearizeFactor);
+						if(pHull->m_transparency == 1.0f && CastsShadow(pLight, pHull))
+							m_visibilityPolygon.AddHull(*pHull, pHull->m_renderLightOverHull);
+					}
 
-					// Render the current light
-					pLight->RenderLightSolidPortion();
+					float lowerAngle, upperAngle;
+					pLight->GetAngularRange(lowerAngle, upperAngle);
 
-					sf::Shader::bind(NULL);
+					m_visibilityPolygon.Compute(lowerAngle, upperAngle, std::min(pif / 24.0f / std::max(pLight->m_detail, 0.01f), pif / 4.0f));
 				}
-				else
-					// Render the current light
-					pLight->RenderLightSolidPortion();
 
-				// Mask off lights
-				if(m_checkForHullIntersect)
-					for(unsigned int h = 0; h < numHulls; h++)
+				// Lights that only need their umbras masked off can go straight to the composition. Their bloom would need a second stencil pass,
+				// so bright lights go through the light temp texture, which is composited into the bloom texture too
+				bool useStencil = m_useStencilShadows && m_stencilAvailable && CanSkipLightTemp(pLight) && !(m_useBloom && pLight->m_intensity > 1.0f);
+
+				for(unsigned int h = 0; h < numShadowHulls && useStencil; h++)
+					if(static_cast<ConvexHull*>(shadowHulls[h])->m_transparency != 1.0f)
+						useStencil = false;
+
+				m_batchCurrentLight = m_batchShadows || useStencil;
+
+				if(useStencil)
+					RenderLightStencil(pLight, shadowHulls, regionHulls, lightScreenRegion, pClipRegion, useVisibilityPolygon);
+				else
+				{
+					// Activate the intermediate render Texture
+					if(!cached)
 					{
-						ConvexHull* pHull = static_cast<ConvexHull*>(regionHulls[h]);
+						SwitchLightTemp();
 
-						Vec2f hullToLight(pLight->m_center - pHull->GetWorldCenter());
-						hullToLight = hullToLight.Normalize() * pLight->m_size;
+						// Restrict clearing, rendering and compositing to the light
+						if(m_scissorLights)
+						{
+							glEnable(GL_SCISSOR_TEST);
+							ScissorScreenRegion(lightScreenRegion);
+						}
 
-						if(!pHull->PointInsideHull(pLight->m_center - hullToLight))
-							MaskShadow(pLight, pHull, !pHull->m_renderLightOverHull, 2.0f);
+						ClearLightTexture(m_lightTempTexture);
+
+						CameraSetup();
+
+						// Reset color
+						glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 					}
-				else
-					for(unsigned int h = 0; h < numHulls; h++)
+					else
 					{
-						ConvexHull* pHull = static_cast<ConvexHull*>(regionHulls[h]);
+						m_staticLightAtlas.BeginRegion(pLight->m_staticRegion);
+						m_currentRenderTexture = cur_lightStatic;
 
-						MaskShadow(pLight, pHull, !pHull->m_renderLightOverHull, 2.0f);
+						glTranslatef(-pLight->m_aabb.m_lowerBound.x, -pLight->m_aabb.m_lowerBound.y, 0.0f);
 					}
 
-				// Render the hulls only for the hulls that had
-				// there shadows rendered earlier (not out of bounds)
-				for(unsigned int h = 0; h < numHulls; h++)
-					static_cast<ConvexHull*>(regionHulls[h])->RenderHull(2.0f);
+					if(pLight->m_shaderAttenuation)
+					{
+						sf::Shader::bind(&m_lightAttenuationShader);
+
+						// Pixels of the light temp texture or of the atlas region
+						const float shaderScale = cached ? pLight->m_staticRegion.m_scale : m_pixelScale;
+
+						if(!cached)
+							m_lightAttenuationShader.setParameter("lightPos", (pLight->m_center.x - m_viewAABB.m_lowerBound.x) * shaderScale, (pLight->m_center.y - m_viewAABB.m_lowerBound.y) * shaderScale);
+						else
+						{
+							// Fragment coordinates include the region origin, and the region projection is flipped
+							const StaticLightAtlas::Region &region = pLight->m_staticRegion;
+
+							m_lightAttenuationShader.setParameter("lightPos", region.m_x + (pLight->m_center.x - pLight->m_aabb.m_lowerBound.x) * shaderScale,
+								region.m_y + region.m_height - (pLight->m_center.y - pLight->m_aabb.m_lowerBound.y) * shaderScale);
+						}
+
+						// Light masks are tinted when composited
+						if(!cached && !m_lightMaskShaderAvailable)
+						{
+							const Color3f lightTint(GetLightTint(pLight));
+
+							m_lightAttenuationShader.setParameter("lightColor", lightTint.r, lightTint.g, lightTint.b);
+						}
+						else
+							m_lightAttenuationShader.setParameter("lightColor", 1.0f, 1.0f, 1.0f);
+
+						m_lightAttenuationShader.setParameter("radius", pLight->m_radius * shaderScale);
+						m_lightAttenuationShader.setParameter("bleed", pLight->m_bleed * shaderScale);
+						m_lightAttenuationShader.setParameter("linearizeFactor", pLight->m_linearizeFactor);
+
+						// Render the current light
+						if(useVisibilityPolygon)
+							m_visibilityPolygon.Render();
+						else
+							pLight->RenderLightSolidPortion();
+
+						sf::Shader::bind(NULL);
+					}
+					else
+						// Render the current light
+						pLight->RenderLightSolidPortion();
+
+					// The visibility polygon already leaves out the umbras of opaque hulls, so it needs the regular masking
+					if(m_extrudeShadows && m_hullEdgeBuffer.Available() && !useVisibilityPolygon)
+					{
+						m_extrudedHulls.clear();
 
-				// Soft light angle fins (additional masking)
-				pLight->RenderLightSoftPortion();
+						for(unsigned int h = 0; h < numShadowHulls; h++)
+						{
+							ConvexHull* pHull = static_cast<ConvexHull*>(shadowHulls[h]);
 
-				// Color reset
-				glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+							if(CastsShadow(pLight, pHull))
+								m_extrudedHulls.push_back(pHull);
+						}
 
-				// Now render that intermediate render Texture to the main render Texture
-				if(pLight->AlwaysUpdate())
-				{
-					m_lightTempTexture.display();
+						m_hullEdgeBuffer.Render(pLight->m_center, pLight->m_radius, m_hardShadowsCurrentLight ? 0.0f : pLight->m_size, m_extrudedHulls, m_softShadowTexture);
+					}
+					else
+					{
+						MaskShadows(pLight, shadowHulls, pClipRegion, useVisibilityPolygon);
 
-					SwitchComposition();
-					glLoadIdentity();
+						if(m_batchCurrentLight)
+							m_shadowBatch.Render(&m_softShadowTexture);
+					}
 
-					sf::Texture::bind(&m_lightTempTexture.getTexture());
+					// Render the hulls only for the hulls that had
+					// there shadows rendered earlier (not out of bounds)
+					for(unsigned int h = 0; h < numHulls; h++)
+						static_cast<ConvexHull*>(regionHulls[h])->RenderHull(2.0f);
 
-					glBlendFunc(GL_ONE, GL_ONE);
+					// Soft light angle fins (additional masking)
+					pLight->RenderLightSoftPortion();
 
-					// Texture is upside-down for some reason, so draw flipped
-					glBegin(GL_QUADS);
-						glTexCoord2i(0, 1); glVertex2f(0.0f, 0.0f);
-						glTexCoord2i(1, 1); glVertex2f(viewSize.x, 0.0f);
-						glTexCoord2i(1, 0); glVertex2f(viewSize.x, viewSize.y);
-						glTexCoord2i(0, 0); glVertex2f(0.0f, viewSize.y);
-					glEnd();
+					// Color reset
+					glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 
-					// Bloom render
-					if(m_useBloom && pLight->m_intensity > 1.0f)
+					// Now render that intermediate render Texture to the main render Texture
+					if(!cached)
 					{
-						SwitchBloom();
+						if(m_scissorLights)
+							glDisable(GL_SCISSOR_TEST);
+
+						m_lightTempTexture.display();
+
+						SwitchComposition();
 						glLoadIdentity();
 
 						sf::Texture::bind(&m_lightTempTexture.getTexture());
 
 						glBlendFunc(GL_ONE, GL_ONE);
-	
-						// Bloom amount
-						glColor4f(1.0f, 1.0f, 1.0f, pLight->m_intensity - 1.0f);
 
-						// Texture is upside-down for some reason, so draw flipped
-						glBegin(GL_QUADS);
-							glTexCoord2i(0, 1); glVertex2f(0.0f, 0.0f);
-							glTexCoord2i(1, 1); glVertex2f(viewSize.x, 0.0f);
-							glTexCoord2i(1, 0); glVertex2f(viewSize.x, viewSize.y);
-							glTexCoord2i(0, 0); glVertex2f(0.0f, viewSize.y);
-						glEnd();
+						if(m_lightMaskShaderAvailable)
+						{
+							const Color3f lightTint(GetLightTint(pLight));
 
-						glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-					}
-				}
-				else
-				{
-					pLight->m_pStaticTexture->display();
+							m_lightMaskShader.setParameter("tint", lightTint.r, lightTint.g, lightTint.b);
 
-					SwitchComposition();
-					CameraSetup();
+							sf::Shader::bind(&m_lightMaskShader);
+						}
 
-					sf::Texture::bind(&pLight->m_pStaticTexture->getTexture());
+						RenderLightTempRegion(lightScreenRegion);
 
-					glTranslatef(pLight->m_center.x - staticTextureOffset.x, pLight->m_center.y - staticTextureOffset.y, 0.0f);
+						if(m_useBloom && pLight->m_intensity > 1.0f)
+						{
+							SwitchBloom();
+							glLoadIdentity();
 
-					glBlendFunc(GL_ONE, GL_ONE);
+							sf::Texture::bind(&m_lightTempTexture.getTexture());
 
-					sf::Vector2u lightStaticTextureSize(pLight->m_pStaticTexture->getSize());
-					const float lightStaticTextureWidth = static_cast<float>(lightStaticTextureSize.x);
-					const float lightStaticTextureHeight = static_cast<float>(lightStaticTextureSize.y);
+							glBlendFunc(GL_ONE, GL_ONE);
 
-					glBegin(GL_QUADS);
-						glTexCoord2i(0, 0); glVertex2f(0.0f, 0.0f);
-						glTexCoord2i(1, 0); glVertex2f(lightStaticTextureWidth, 0.0f);
-						glTexCoord2i(1, 1); glVertex2f(lightStaticTextureWidth, lightStaticTextureHeight);
-						glTexCoord2i(0, 1); glVertex2f(0.0f, lightStaticTextureHeight);
-					glEnd();
+							const Color3f bloomTint(GetBloomTint(pLight));
 
-					// Bloom render
-					if(m_useBloom && pLight->m_intensity > 1.0f)
-					{
-						SwitchBloom();
-						CameraSetup();
+							// Without the shader, the light temp texture already holds the tinted light
+							if(m_lightMaskShaderAvailable)
+								m_lightMaskShader.setParameter("tint", bloomTint.r, bloomTint.g, bloomTint.b);
+							else
+								glColor4f(pLight->m_intensity - 1.0f, pLight->m_intensity - 1.0f, pLight->m_intensity - 1.0f, 1.0f);
 
-						glTranslatef(pLight->m_center.x - staticTextureOffset.x, pLight->m_center.y - staticTextureOffset.y, 0.0f);
+							RenderLightTempRegion(lightScreenRegion);
 
-						sf::Texture::bind(&pLight->m_pStaticTexture->getTexture());
+							glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+						}
 
-						glBlendFunc(GL_ONE, GL_ONE);
-	
-						// Bloom amount
-						glColor4f(1.0f, 1.0f, 1.0f, pLight->m_intensity - 1.0f);
+						if(m_lightMaskShaderAvailable)
+							sf::Shader::bind(NULL);
+					}
+					else
+					{
+						m_staticLightAtlas.EndRegion(pLight->m_staticRegion);
 
-						glBegin(GL_QUADS);
-							glTexCoord2i(0, 0); glVertex2f(0.0f, 0.0f);
-							glTexCoord2i(1, 0); glVertex2f(lightStaticTextureWidth, 0.0f);
-							glTexCoord2i(1, 1); glVertex2f(lightStaticTextureWidth, lightStaticTextureHeight);
-							glTexCoord2i(0, 1); glVertex2f(0.0f, lightStaticTextureHeight);
-						glEnd();
+						// Composited with the other cached lights after the loop
+						if(visible)
+						{
+							m_staticLightAtlas.AddToComposite(pLight->m_staticRegion, pLight->m_aabb.m_lowerBound, pLight->m_color, pLight->m_intensity, target_composition);
 
-						glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+							if(m_useBloom && pLight->m_intensity > 1.0f)
+								m_staticLightAtlas.AddToComposite(pLight->m_staticRegion, pLight->m_aabb.m_lowerBound, pLight->m_color, pLight->m_intensity - 1.0f, target_bloom);
+						}
 					}
 				}
 
 				pLight->m_updateRequired = false;
+
+				if(cached && pLight->AlwaysUpdate())
+				{
+					pLight->m_cachedCenter = pLight->m_center;
+					pLight->m_cachedRadius = pLight->m_radius;
+					pLight->m_cachedFrame = m_frame;
+					pLight->m_hullDrift = 0.0f;
+				}
 			}
-			else
+			else if(visible)
 			{
-				SwitchComposition();
+				m_staticLightAtlas.AddToComposite(pLight->m_staticRegion, pLight->m_aabb.m_lowerBound, pLight->m_color, pLight->m_intensity, target_composition);
 
-				// Render existing texture
-				sf::Texture::bind(&pLight->m_pStaticTexture->getTexture());
+				if(m_useBloom && pLight->m_intensity > 1.0f)
+					m_staticLightAtlas.AddToComposite(pLight->m_staticRegion, pLight->m_aabb.m_lowerBound, pLight->m_color, pLight->m_intensity - 1.0f, target_bloom);
+			}
 
-				Vec2f staticTextureOffset(pLight->m_center - pLight->m_aabb.m_lowerBound);
+			regionHulls.clear();
+		}
 
-				CameraSetup();
-				glTranslatef(pLight->m_center.x - staticTextureOffset.x, pLight->m_center.y - staticTextureOffset.y, 0.0f);
+		// Dynamic lights that are not shown from a cached texture anymore give it up
+		for(unsigned int l = 0; l < numVisibleLights; l++)
+		{
+			Light* pLight = lightOrder[l].second;
 
-				glBlendFunc(GL_ONE, GL_ONE);
+			if(!pLight->AlwaysUpdate())
+				continue;
 
-				sf::Vector2u lightStaticTextureSize(pLight->m_pStaticTexture->getSize());
-				const float lightStaticTextureWidth = static_cast<float>(lightStaticTextureSize.x);
-				const float lightStaticTextureHeight = static_cast<float>(lightStaticTextureSize.y);
+			if(!pLight->m_amortized && pLight->m_staticRegion.m_page != -1)
+				m_staticLightAtlas.Free(pLight->m_staticRegion);
 
-				glBegin(GL_QUADS);
-					glTexCoord2i(0, 0); glVertex2f(0.0f, 0.0f);
-					glTexCoord2i(1, 0); glVertex2f(lightStaticTextureWidth, 0.0f);
-					glTexCoord2i(1, 1); glVertex2f(lightStaticTextureWidth, lightStaticTextureHeight);
-					glTexCoord2i(0, 1); glVertex2f(0.0f, lightStaticTextureHeight);
-				glEnd();
+			pLight->m_previousCenter = pLight->m_center;
+		}
 
-				// Bloom render
-				if(m_useBloom && pLight->m_intensity > 1.0f)
-				{
-					SwitchBloom();
-					CameraSetup();
+		// Cached lights, with one draw per atlas page
+		SwitchComposition();
+		CameraSetup();
 
-					glTranslatef(pLight->m_center.x - staticTextureOffset.x, pLight->m_center.y - staticTextureOffset.y, 0.0f);
+		glBlendFunc(GL_ONE, GL_ONE);
 
-					sf::Texture::bind(&pLight->m_pStaticTexture->getTexture());
+		m_staticLightAtlas.RenderComposite(target_composition);
 
-					glBlendFunc(GL_ONE, GL_ONE);
-	
-					// Bloom amount
-					glColor4f(1.0f, 1.0f, 1.0f, pLight->m_intensity - 1.0f);
+		if(!m_freeLightBatch.Empty())
+		{
+			SwitchComposition();
+			CameraSetup();
 
-					glBegin(GL_QUADS);
-						glTexCoord2i(0, 0); glVertex2f(0.0f, 0.0f);
-						glTexCoord2i(1, 0); glVertex2f(lightStaticTextureWidth, 0.0f);
-						glTexCoord2i(1, 1); glVertex2f(lightStaticTextureWidth, lightStaticTextureHeight);
-						glTexCoord2i(0, 1); glVertex2f(0.0f, lightStaticTextureHeight);
-					glEnd();
+			glBlendFunc(GL_ONE, GL_ONE);
 
-					glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-				}
-			}
+			m_freeLightBatch.Render();
+		}
 
-			regionHulls.clear();
+		if(!m_tiledLightGrid.Empty())
+		{
+			SwitchComposition();
+
+			// The grid is in composition pixels
+			glLoadIdentity();
+			glScalef(1.0f / m_pixelScale, 1.0f / m_pixelScale, 1.0f);
+
+			glBlendFunc(GL_ONE, GL_ONE);
+
+			m_tiledLightGrid.Render();
+		}
+
+		if(!m_distanceField.Empty(target_composition))
+		{
+			SwitchComposition();
+			CameraSetup();
+
+			glBlendFunc(GL_ONE, GL_ONE);
+
+			m_distanceField.Render(target_composition);
+		}
+
+		if(!m_shadowMap.Empty())
+		{
+			SwitchComposition();
+			CameraSetup();
+
+			glBlendFunc(GL_ONE, GL_ONE);
+
+			m_shadowMap.Render(target_composition);
+		}
+
+		// Intensity above 1 of the lights drawn in batches, the lights through the light temp texture added theirs in the loop
+		if(m_useBloom)
+		{
+			SwitchBloom();
+			CameraSetup();
+
+			glBlendFunc(GL_ONE, GL_ONE);
+
+			m_staticLightAtlas.RenderComposite(target_bloom);
+
+			if(!m_bloomLightBatch.Empty())
+				m_bloomLightBatch.Render();
+
+			if(!m_distanceField.Empty(target_bloom))
+				m_distanceField.Render(target_bloom);
+
+			if(!m_shadowMap.Empty())
+				m_shadowMap.Render(target_bloom);
 		}
 
 		// Emissive lights
@@ -923,36 +2095,72 @@ namespace ltbl
 
 		const unsigned int numEmissiveLights = visibleEmissiveLights.size();
 
+		m_emissiveBatch.Clear();
+
 		for(unsigned int i = 0; i < numEmissiveLights; i++)
 		{
 			EmissiveLight* pEmissive = static_cast<EmissiveLight*>(visibleEmissiveLights[i]);
 
-			if(m_useBloom && pEmissive->m_intensity > 1.0f)
-			{
-				SwitchBloom();
-				CameraSetup();
-				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-				pEmissive->Render();
-			}
-			else
-			{
-				SwitchComposition();
-				CameraSetup();
-				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-				pEmissive->Render();
-			}
+			m_emissiveBatch.AddEmissive(pEmissive, m_useBloom && pEmissive->m_intensity > 1.0f ? target_bloom : target_composition);
+		}
+
+		if(numEmissiveLights != 0)
+		{
+			m_emissiveBatch.PackTextures();
+
+			// Packing may have activated the atlas, so the next switch has to restore the projection
+			m_currentRenderTexture = cur_lightStatic;
+		}
+
+		if(!m_emissiveBatch.Empty(target_bloom))
+		{
+			SwitchBloom();
+			CameraSetup();
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			m_emissiveBatch.Render(target_bloom);
+		}
+
+		if(!m_emissiveBatch.Empty(target_composition))
+		{
+			SwitchComposition();
+			CameraSetup();
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			m_emissiveBatch.Render(target_composition);
 		}
 
-		m_bloomTexture.display();
+		if(m_useBloom)
+			m_bloomTexture.display();
 
 		m_compositionTexture.display();
 
+		// Blur the bright parts once for all lights
+		if(m_useBloom)
+		{
+			m_bloomPipeline.Render(m_compositionTexture.getTexture(), m_bloomTexture.getTexture(), m_bloomThreshold, m_bloomQuality);
+
+			// The pipeline activates its own render textures, so the next switch has to restore the projection
+			m_currentRenderTexture = cur_lightStatic;
+		}
+
+		// After the bloom pipeline, so its levels are included as far as the driver keeps the contexts in order
+		m_compositionTexture.setActive();
+		m_gpuTimer.End();
+
 		SwitchWindow();
+
+		m_lightingCPUTime = m_lightingClock.getElapsedTime().asSeconds() * 1000.0f;
+
+		// The CPU and the GPU work in parallel, so the slower one limits the frame
+		if(m_useGovernor)
+			m_governor.Update(std::max(m_lightingCPUTime, m_gpuTimer.GetTime()));
 	}
 
 	void LightSystem::BuildLight(Light* pLight)
 	{
-		m_lightsToPreBuild.push_back(pLight);
+		pLight->m_updateRequired = true;
+
+		if(std::find(m_lightsToPreBuild.begin(), m_lightsToPreBuild.end(), pLight) == m_lightsToPreBuild.end())
+			m_lightsToPreBuild.push_back(pLight);
 	}
 
 	void LightSystem::RenderLightTexture()
@@ -963,6 +2171,7 @@ namespace ltbl
 		// because SFML stores view transformations in the projection matrix
 		glTranslatef(m_viewAABB.GetLowerBound().x, -m_viewAABB.GetLowerBound().y, 0.0f);
 
+		// Smooth, so a composition at a lower lighting scale is upsampled bilinearly
 		sf::Texture::bind(&m_compositionTexture.getTexture());
 
 		// Set up color function to multiply the existing color with the render texture color
@@ -975,9 +2184,9 @@ namespace ltbl
 			glTexCoord2i(0, 1); glVertex2f(0.0f, viewSize.y);
 		glEnd();
 
-		if(m_useBloom)
+		if(m_useBloom && m_bloomPipeline.Available())
 		{
-			sf::Texture::bind(&m_bloomTexture.getTexture());
+			sf::Texture::bind(&m_bloomPipeline.GetTexture());
 
 			glBlendFunc(GL_ONE, GL_ONE);
 
@@ -995,6 +2204,16 @@ namespace ltbl
 		m_pWin->resetGLStates();
 	}
 
+	float LightSystem::GetLightingCPUTime() const
+	{
+		return m_lightingCPUTime;
+	}
+
+	float LightSystem::GetLightingGPUTime() const
+	{
+		return m_gpuTimer.GetTime();
+	}
+
 	void LightSystem::DebugRender()
 	{
 		// Set to a more useful-for-OpenGL projection
@@ -24,7 +24,9 @@
 
 #include <LTBL/Utils.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 
 namespace ltbl
 {
@@ -56,13 +58,18 @@ namespace ltbl
 
 		glVertex2f(m_center.x, m_center.y);
       
-		// Set the edge color for rest of shape
-		int numSubdivisions = static_cast<int>(m_spreadAngle / m_lightSubdivisionSize);
+		// Coarser for lights that are small on screen, but at least 8 subdivisions around
+		float subdivisionSize = std::min(m_lightSubdivisionSize / std::max(m_detail, 0.01f), std::max(m_lightSubdivisionSize, pif / 4.0f));
+
+		// Set the edge color for rest of shape. Rounded up and spread evenly, so the fan always covers the whole spread
+		int numSubdivisions = std::max(static_cast<int>(std::ceil(m_spreadAngle / subdivisionSize - 0.001f)), 1);
+		subdivisionSize = m_spreadAngle / numSubdivisions;
+
 		float startAngle = m_directionAngle - m_spreadAngle / 2.0f;
       
 		for(int currentSubDivision = 0; currentSubDivision <= numSubdivisions; currentSubDivision++)
 		{
-			float angle = startAngle + currentSubDivision * m_lightSubdivisionSize;
+			float angle = startAngle + currentSubDivision * subdivisionSize;
 			glVertex2f(m_radius * cosf(angle) + m_center.x, m_radius * sinf(angle) + m_center.y);  
 		}
 
@@ -99,7 +106,8 @@ namespace ltbl
 
 	void Light_Point::CalculateAABB()
 	{
-		if(m_spreadAngle == pifTimes2 || m_spreadAngle == 0.0f) // 1 real value, 1 flag
+		// The triangle below does not contain spreads of half a turn or more, those get the whole disk
+		if(m_spreadAngle == pifTimes2 || m_spreadAngle == 0.0f || m_spreadAngle >= pif) // 1 real value, 1 flag
 		{
 			Vec2f diff(m_radius, m_radius);
 			m_aabb.m_lowerBound = m_center - diff;
@@ -158,6 +166,25 @@ namespace ltbl
 		m_aabb.CalculateCenter();
 	}
 
+	void Light_Point::GetAngularRange(float &lowerAngle, float &upperAngle)
+	{
+		if(m_spreadAngle == pifTimes2)
+		{
+			lowerAngle = 0.0f;
+			upperAngle = pifTimes2;
+		}
+		else
+		{
+			lowerAngle = m_directionAngle - m_spreadAngle / 2.0f;
+			upperAngle = m_directionAngle + m_spreadAngle / 2.0f;
+		}
+	}
+
+	bool Light_Point::HasSoftPortion()
+	{
+		return m_spreadAngle != pifTimes2 && m_softSpreadAngle != 0.0f;
+	}
+
 	void Light_Point::SetDirectionAngle(float directionAngle)
 	{
 		assert(AlwaysUpdate());
@@ -0,0 +1,282 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <LTBL/Light/PolarShadowMap.h>
+#include <LTBL/Utils.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <string>
+
+namespace ltbl
+{
+	PolarShadowMap::PolarShadowMap()
+		: m_resolution(0), m_maxLights(0), m_numLights(0), m_radius(0.0f), m_uploaded(false), m_available(false)
+	{
+	}
+
+	void PolarShadowMap::Create(bool useVertexBuffer, unsigned int resolution, unsigned int maxLights)
+	{
+		for(int i = 0; i < num_lightTargets; i++)
+			m_quads[i].Create(useVertexBuffer);
+
+		m_resolution = resolution;
+		m_maxLights = maxLights;
+		m_numLights = 0;
+
+		m_distances.resize(m_resolution);
+
+		m_binDirections.resize(m_resolution);
+
+		for(unsigned int i = 0; i < m_resolution; i++)
+		{
+			float angle = (i + 0.5f) * pifTimes2 / m_resolution - pif;
+
+			m_binDirections[i] = Vec2f(std::cos(angle), std::sin(angle));
+		}
+
+		m_pixels.assign(m_resolution * m_maxLights * 4, 255);
+
+		m_available = false;
+
+		if(!sf::Shader::isAvailable() || !m_texture.create(m_resolution, m_maxLights))
+			return;
+
+		// Distances are encoded, so they can not be interpolated. Angles wrap around
+		m_texture.setSmooth(false);
+		m_texture.setRepeated(true);
+
+		// The penumbra widens behind the occluder like the shadow fins do, its width is found from the
+		// average occluder distance around the fragment, as in percentage closer soft shadows
+		const std::string fragmentShaderSource =
+			"uniform sampler2D shadowMap;\n"
+			"varying vec3 light;\n"
+			"varying vec4 params;\n"
+			"varying vec2 range;\n"
+			"const float pi = 3.14159265;\n" +
+			LightQuads::GetAttenuationSource() +
+			"float Sample(float angle)\n"
+			"{\n"
+			"	vec4 texel = texture2D(shadowMap, vec2((angle + pi) / (2.0 * pi), params.w));\n"
+			"	return (texel.r * 65280.0 + texel.g * 255.0) / 65535.0 * light.z;\n"
+			"}\n"
+			"void main()\n"
+			"{\n"
+			"	vec2 toFragment = gl_FragCoord.xy - light.xy;\n"
+			"	float dist = length(toFragment);\n"
+			"	float angle = atan(toFragment.y, toFragment.x);\n"
+			"	if(mod(angle - range.x, 2.0 * pi) > range.y)\n"
+			"		discard;\n"
+			"	float attenuation = Attenuation(dist, light.z, params.x, params.y);\n"
+			"	float search = min(params.z / max(dist, 1.0), 0.5);\n"
+			"	float occluderSum = 0.0;\n"
+			"	float numOccluders = 0.0;\n"
+			"	for(int i = -4; i <= 4; i++)\n"
+			"	{\n"
+			"		float occluder = Sample(angle + search * float(i) / 4.0);\n"
+			"		if(occluder < dist)\n"
+			"		{\n"
+			"			occluderSum += occluder;\n"
+			"			numOccluders += 1.0;\n"
+			"		}\n"
+			"	}\n"
+			"	float lit = 1.0;\n"
+			"	if(numOccluders > 0.0)\n"
+			"	{\n"
+			"		float occluder = max(occluderSum / numOccluders, 1.0);\n"
+			"		float spread = min(params.z * (dist - occluder) / (occluder * dist), 0.5);\n"
+			"		lit = 0.0;\n"
+			"		for(int i = -4; i <= 4; i++)\n"
+			"		{\n"
+			"			if(dist <= Sample(angle + spread * float(i) / 4.0) + 0.5)\n"
+			"				lit += 1.0;\n"
+			"		}\n"
+			"		lit /= 9.0;\n"
+			"	}\n"
+			"	gl_FragColor = vec4(gl_Color.rgb * attenuation * lit, 1.0);\n"
+			"}\n";
+
+		if(!m_shader.loadFromMemory(LightQuads::GetVertexShaderSource(), fragmentShaderSource))
+			return;
+
+		m_shader.setParameter("shadowMap", m_texture);
+
+		m_available = true;
+	}
+
+	bool PolarShadowMap::Available() const
+	{
+		return m_available;
+	}
+
+	bool PolarShadowMap::Full() const
+	{
+		return m_numLights >= m_maxLights;
+	}
+
+	void PolarShadowMap::Clear()
+	{
+		m_numLights = 0;
+		m_uploaded = false;
+
+		for(int i = 0; i < num_lightTargets; i++)
+			m_quads[i].Clear();
+	}
+
+	bool PolarShadowMap::Empty() const
+	{
+		return m_numLights == 0;
+	}
+
+	void PolarShadowMap::BeginLight(const Vec2f &center, float radius, float size, const Color3f &color, const Color3f &bloomColor, float bleed, float linearizeFactor,
+		float lowerAngle, float upperAngle, const Vec2f &pixelOffset, float pixelScale)
+	{
+		assert(!Full());
+
+		m_center = center;
+		m_radius = radius;
+
+		std::fill(m_distances.begin(), m_distances.end(), 1.0f);
+
+		const float row = (m_numLights + 0.5f) / m_maxLights;
+
+		m_quads[target_composition].AddLight(center, radius, size, color, bleed, linearizeFactor, lowerAngle, upperAngle, row, pixelOffset, pixelScale);
+
+		if(bloomColor.r > 0.0f || bloomColor.g > 0.0f || bloomColor.b > 0.0f)
+			m_quads[target_bloom].AddLight(center, radius, size, bloomColor, bleed, linearizeFactor, lowerAngle, upperAngle, row, pixelOffset, pixelScale);
+	}
+
+	void PolarShadowMap::AddHull(const ConvexHull &hull)
+	{
+		const unsigned int numVertices = hull.m_vertices.size();
+
+		Vec2f hCenter(hull.GetWorldCenter());
+
+		for(unsigned int i = 0; i < numVertices; i++)
+		{
+			Vec2f start(hull.GetWorldVertex(i));
+			Vec2f end(hull.GetWorldVertex(Wrap(i + 1, numVertices)));
+
+			Vec2f edge(end - start);
+
+			// Same test as for the visibility polygon
+			bool backFacing = (edge.Cross(hCenter - start) >= 0.0f) == (edge.Cross(m_center - start) >= 0.0f);
+
+			if(!hull.m_renderLightOverHull || backFacing)
+				AddEdge(start, end);
+		}
+	}
+
+	void PolarShadowMap::AddEdge(const Vec2f &start, const Vec2f &end)
+	{
+		Vec2f toStart(start - m_center);
+		Vec2f toEnd(end - m_center);
+
+		float startAngle = std::atan2(toStart.y, toStart.x);
+		float angleDelta = std::atan2(toEnd.y, toEnd.x) - startAngle;
+
+		// Shortest way around, edges of hulls that do not contain the light span less than half a turn
+		if(angleDelta > pif)
+			angleDelta -= pifTimes2;
+		else if(angleDelta < -pif)
+			angleDelta += pifTimes2;
+
+		float lowerAngle = std::min(startAngle, startAngle + angleDelta);
+		float upperAngle = std::max(startAngle, startAngle + angleDelta);
+
+		const float binsPerRadian = m_resolution / pifTimes2;
+
+		// Bins whose center angle lies in the span
+		int lowerBin = static_cast<int>(std::ceil((lowerAngle + pif) * binsPerRadian - 0.5f));
+		int upperBin = static_cast<int>(std::floor((upperAngle + pif) * binsPerRadian - 0.5f));
+
+		Vec2f edge(end - start);
+
+		const int resolution = static_cast<int>(m_resolution);
+
+		for(int b = lowerBin; b <= upperBin; b++)
+		{
+			const int bin = Wrap(b, resolution);
+
+			float denom = m_binDirections[bin].Cross(edge);
+
+			// Parallel
+			if(std::abs(denom) < 0.000001f)
+				continue;
+
+			float t = toStart.Cross(edge) / denom;
+
+			if(t < 0.0f)
+				continue;
+
+			float distance = t / m_radius;
+
+			m_distances[bin] = std::min(m_distances[bin], distance);
+		}
+	}
+
+	void PolarShadowMap::EncodeRow()
+	{
+		sf::Uint8* pRow = &m_pixels[m_numLights * m_resolution * 4];
+
+		for(unsigned int i = 0; i < m_resolution; i++)
+		{
+			// 16 bits of distance in red and green
+			unsigned int distance = static_cast<unsigned int>(std::min(std::max(m_distances[i], 0.0f), 1.0f) * 65535.0f);
+
+			pRow[i * 4 + 0] = static_cast<sf::Uint8>(distance >> 8);
+			pRow[i * 4 + 1] = static_cast<sf::Uint8>(distance & 255);
+			pRow[i * 4 + 2] = 0;
+			pRow[i * 4 + 3] = 255;
+		}
+	}
+
+	void PolarShadowMap::EndLight()
+	{
+		EncodeRow();
+
+		m_numLights++;
+	}
+
+	void PolarShadowMap::Render(LightTarget target)
+	{
+		if(m_quads[target].Empty())
+			return;
+
+		if(!m_uploaded)
+		{
+			m_texture.update(&m_pixels[0], m_resolution, m_numLights, 0, 0);
+
+			m_uploaded = true;
+		}
+
+		m_quads[target].Render(m_shader);
+		m_quads[target].Clear();
+
+		for(int i = 0; i < num_lightTargets; i++)
+			if(!m_quads[i].Empty())
+				return;
+
+		Clear();
+	}
+}
@@ -0,0 +1,99 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <LTBL/Light/QualityGovernor.h>
+
+#include <cassert>
+
+namespace ltbl
+{
+	QualityGovernor::Settings::Settings(float lightingScale, unsigned int maxFins, float lightQuality, bool useBloom, float dynamicUpdateThreshold)
+		: m_lightingScale(lightingScale), m_maxFins(maxFins), m_lightQuality(lightQuality), m_useBloom(useBloom),
+		m_dynamicUpdateThreshold(dynamicUpdateThreshold)
+	{
+	}
+
+	QualityGovernor::QualityGovernor()
+		: m_level(0), m_averageTime(0.0f), m_framesSinceChange(0),
+		m_targetTime(4.0f), m_hysteresis(0.25f), m_settleFrames(30)
+	{
+		m_levels.push_back(Settings(1.0f, 1, 1.0f, true, 0.0f));
+		m_levels.push_back(Settings(1.0f, 0, 0.5f, true, 0.5f));
+		m_levels.push_back(Settings(0.75f, 0, 0.5f, true, 1.0f));
+		m_levels.push_back(Settings(0.5f, 0, 0.25f, true, 2.0f));
+		m_levels.push_back(Settings(0.5f, 0, 0.25f, false, 4.0f));
+	}
+
+	bool QualityGovernor::Update(float lightingTime)
+	{
+		assert(!m_levels.empty());
+
+		// Settings may have been removed
+		if(m_level >= m_levels.size())
+			m_level = m_levels.size() - 1;
+
+		m_framesSinceChange++;
+
+		// The first frame after a change includes its cost, such as recreated render textures, so the average starts after it
+		if(m_framesSinceChange <= 2)
+			m_averageTime = lightingTime;
+		else
+			m_averageTime += (lightingTime - m_averageTime) * 0.1f;
+
+		if(m_framesSinceChange < m_settleFrames)
+			return false;
+
+		if(m_averageTime > m_targetTime && m_level + 1 < m_levels.size())
+			m_level++;
+		else if(m_averageTime < m_targetTime * (1.0f - m_hysteresis) && m_level > 0 && m_framesSinceChange >= m_settleFrames * 4)
+			m_level--;
+		else
+			return false;
+
+		m_framesSinceChange = 0;
+
+		return true;
+	}
+
+	void QualityGovernor::Reset()
+	{
+		m_level = 0;
+		m_framesSinceChange = 0;
+	}
+
+	unsigned int QualityGovernor::GetLevel() const
+	{
+		return m_level;
+	}
+
+	const QualityGovernor::Settings &QualityGovernor::GetSettings() const
+	{
+		assert(!m_levels.empty());
+
+		return m_levels[m_level < m_levels.size() ? m_level : m_levels.size() - 1];
+	}
+
+	float QualityGovernor::GetAverageTime() const
+	{
+		return m_averageTime;
+	}
+}
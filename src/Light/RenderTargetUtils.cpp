@@ -0,0 +1,43 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+
+#include <LTBL/Light/RenderTargetUtils.h>
+
+#include <SFML/OpenGL.hpp>
+
+namespace ltbl
+{
+	void RenderFullTarget(const sf::RenderTexture &target)
+	{
+		sf::Vector2u size(target.getSize());
+		const float width = static_cast<float>(size.x);
+		const float height = static_cast<float>(size.y);
+
+		glBegin(GL_QUADS);
+			glVertex2f(0.0f, 0.0f);
+			glVertex2f(width, 0.0f);
+			glVertex2f(width, height);
+			glVertex2f(0.0f, height);
+		glEnd();
+	}
+}
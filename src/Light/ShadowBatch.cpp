@@ -0,0 +1,198 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
+#include <LTBL/Light/ShadowBatch.h>
+
+#include <SFML/OpenGL.hpp>
+
+#include <cstddef>
+
+namespace ltbl
+{
+	void ShadowBatch::Create(bool useVertexBuffer)
+	{
+		m_stream.Create(useVertexBuffer);
+	}
+
+	void ShadowBatch::Clear()
+	{
+		for(int i = 0; i < num_blendModes; i++)
+			m_vertices[i].clear();
+	}
+
+	bool ShadowBatch::Empty() const
+	{
+		for(int i = 0; i < num_blendModes; i++)
+			if(!m_vertices[i].empty())
+				return false;
+
+		return true;
+	}
+
+	bool ShadowBatch::Empty(BlendMode mode) const
+	{
+		return m_vertices[mode].empty();
+	}
+
+	void ShadowBatch::AddVertex(BlendMode mode, const Vec2f &position, const Vec2f &texCoord, float depth, float alpha)
+	{
+		Vertex vertex;
+
+		vertex.m_x = position.x;
+		vertex.m_y = position.y;
+		vertex.m_z = depth;
+		vertex.m_u = texCoord.x;
+		vertex.m_v = texCoord.y;
+
+		// Color is ignored by the blend functions, only alpha matters
+		vertex.m_r = 1.0f;
+		vertex.m_g = 1.0f;
+		vertex.m_b = 1.0f;
+		vertex.m_a = alpha;
+
+		m_vertices[mode].push_back(vertex);
+	}
+
+	void ShadowBatch::AddPolygon(BlendMode mode, const std::vector<Vec2f> &positions, const std::vector<Vec2f> &texCoords, float depth, float alpha)
+	{
+		for(unsigned int i = 2, numVertices = positions.size(); i < numVertices; i++)
+		{
+			AddVertex(mode, positions[0], texCoords[0], depth, alpha);
+			AddVertex(mode, positions[i - 1], texCoords[i - 1], depth, alpha);
+			AddVertex(mode, positions[i], texCoords[i], depth, alpha);
+		}
+	}
+
+	void ShadowBatch::AddPolygon(BlendMode mode, const std::vector<Vec2f> &positions, const Vec2f &texCoord, float depth, float alpha)
+	{
+		for(unsigned int i = 2, numVertices = positions.size(); i < numVertices; i++)
+		{
+			AddVertex(mode, positions[0], texCoord, depth, alpha);
+			AddVertex(mode, positions[i - 1], texCoord, depth, alpha);
+			AddVertex(mode, positions[i], texCoord, depth, alpha);
+		}
+	}
+
+	void ShadowBatch::AddTriangleStrip(BlendMode mode, const std::vector<Vec2f> &strip, const Vec2f &texCoord, float depth, float alpha, const ClipRegion* pClipRegion)
+	{
+		for(unsigned int i = 2, numStripVertices = strip.size(); i < numStripVertices; i++)
+		{
+			if(pClipRegion == NULL)
+			{
+				AddVertex(mode, strip[i - 2], texCoord, depth, alpha);
+				AddVertex(mode, strip[i - 1], texCoord, depth, alpha);
+				AddVertex(mode, strip[i], texCoord, depth, alpha);
+
+				continue;
+			}
+
+			m_tempPositions.resize(3);
+
+			m_tempPositions[0] = strip[i - 2];
+			m_tempPositions[1] = strip[i - 1];
+			m_tempPositions[2] = strip[i];
+
+			m_tempTexCoords.clear();
+
+			pClipRegion->ClipPolygon(m_tempPositions, m_tempTexCoords);
+
+			AddPolygon(mode, m_tempPositions, texCoord, depth, alpha);
+		}
+	}
+
+	void ShadowBatch::Upload()
+	{
+		m_uploadVertices.clear();
+
+		for(int i = 0; i < num_blendModes; i++)
+		{
+			m_uploadOffsets[i] = m_uploadVertices.size();
+			m_uploadVertices.insert(m_uploadVertices.end(), m_vertices[i].begin(), m_vertices[i].end());
+		}
+
+		m_uploadOffsets[num_blendModes] = m_uploadVertices.size();
+
+		if(m_uploadVertices.empty())
+			return;
+
+		const char* pVertices = m_stream.Upload(&m_uploadVertices[0], m_uploadVertices.size() * sizeof(Vertex));
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+
+		glVertexPointer(3, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_x));
+		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_u));
+		glColorPointer(4, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_r));
+	}
+
+	void ShadowBatch::Draw(BlendMode first, BlendMode last)
+	{
+		const unsigned int numVertices = m_uploadOffsets[last + 1] - m_uploadOffsets[first];
+
+		if(numVertices != 0)
+			glDrawArrays(GL_TRIANGLES, m_uploadOffsets[first], numVertices);
+	}
+
+	void ShadowBatch::Finish()
+	{
+		if(!m_uploadVertices.empty())
+		{
+			m_stream.Unbind();
+
+			glDisableClientState(GL_VERTEX_ARRAY);
+			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+			glDisableClientState(GL_COLOR_ARRAY);
+
+			// Color arrays leave the current color undefined
+			glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+		}
+
+		Clear();
+	}
+
+	void ShadowBatch::Render(const sf::Texture* pTexture)
+	{
+		if(Empty())
+			return;
+
+		glEnable(GL_TEXTURE_2D);
+
+		sf::Texture::bind(pTexture);
+
+		Upload();
+
+		// Umbras and multiplied fins are next to each other, so they are drawn at once
+		glBlendFunc(GL_ZERO, GL_SRC_ALPHA);
+
+		Draw(blend_umbra, blend_multiply);
+
+		glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+
+		Draw(blend_multiplyInverse, blend_multiplyInverse);
+
+		Finish();
+	}
+}
@@ -32,7 +32,47 @@ namespace ltbl
 	{
 	}
 
-	void ShadowFin::Render(float transparency)
+	void ShadowFin::RenderTriangle(const Vec2f &rootTexCoord, const Vec2f &penumbraTexCoord, const Vec2f &umbraTexCoord, const ClipRegion* pClipRegion)
+	{
+		if(pClipRegion == NULL)
+		{
+			glBegin(GL_TRIANGLES);
+				glTexCoord2f(rootTexCoord.x, rootTexCoord.y); glVertex2f(m_rootPos.x, m_rootPos.y);
+				glTexCoord2f(penumbraTexCoord.x, penumbraTexCoord.y); glVertex2f(m_rootPos.x + m_penumbra.x, m_rootPos.y + m_penumbra.y);
+				glTexCoord2f(umbraTexCoord.x, umbraTexCoord.y); glVertex2f(m_rootPos.x + m_umbra.x, m_rootPos.y + m_umbra.y);
+			glEnd();
+
+			return;
+		}
+
+		std::vector<Vec2f> positions(3);
+		std::vector<Vec2f> texCoords(3);
+
+		positions[0] = m_rootPos;
+		positions[1] = m_rootPos + m_penumbra;
+		positions[2] = m_rootPos + m_umbra;
+
+		texCoords[0] = rootTexCoord;
+		texCoords[1] = penumbraTexCoord;
+		texCoords[2] = umbraTexCoord;
+
+		pClipRegion->ClipPolygon(positions, texCoords);
+
+		if(positions.empty())
+			return;
+
+		glBegin(GL_TRIANGLE_FAN);
+
+		for(unsigned int i = 0, numVertices = positions.size(); i < numVertices; i++)
+		{
+			glTexCoord2f(texCoords[i].x, texCoords[i].y);
+			glVertex2f(positions[i].x, positions[i].y);
+		}
+
+		glEnd();
+	}
+
+	void ShadowFin::Render(float transparency, const ClipRegion* pClipRegion)
 	{
 		if(m_penumbraBrightness != 1.0f)
 		{
@@ -40,11 +80,7 @@ namespace ltbl
 	
 			glBlendFunc(GL_ZERO, GL_SRC_ALPHA);
 
-			glBegin(GL_TRIANGLES);
-				glTexCoord2i(0, 1); glVertex2f(m_rootPos.x, m_rootPos.y);
-				glTexCoord2i(1, 0); glVertex2f(m_rootPos.x + m_penumbra.x, m_rootPos.y + m_penumbra.y);
-				glTexCoord2i(0, 0); glVertex2f(m_rootPos.x + m_umbra.x, m_rootPos.y + m_umbra.y);
-			glEnd();
+			RenderTriangle(Vec2f(0.0f, 1.0f), Vec2f(1.0f, 0.0f), Vec2f(0.0f, 0.0f), pClipRegion);
 		}
 		else
 		{
@@ -58,13 +94,51 @@ namespace ltbl
 
 			glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
 
-			glBegin(GL_TRIANGLES);
-				glTexCoord2i(0, 1); glVertex2f(m_rootPos.x, m_rootPos.y);
-				glTexCoord2i(0, 0); glVertex2f(m_rootPos.x + m_penumbra.x, m_rootPos.y + m_penumbra.y);
-				glTexCoord2i(1, 0); glVertex2f(m_rootPos.x + m_umbra.x, m_rootPos.y + m_umbra.y);
-			glEnd();
+			RenderTriangle(Vec2f(0.0f, 1.0f), Vec2f(0.0f, 0.0f), Vec2f(1.0f, 0.0f), pClipRegion);
 		}
 	
 		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 	}
+
+	void ShadowFin::AddToBatch(ShadowBatch &batch, float transparency, const ClipRegion* pClipRegion)
+	{
+		std::vector<Vec2f> positions(3);
+		std::vector<Vec2f> texCoords(3);
+
+		positions[0] = m_rootPos;
+		positions[1] = m_rootPos + m_penumbra;
+		positions[2] = m_rootPos + m_umbra;
+
+		ShadowBatch::BlendMode mode;
+		float alpha;
+
+		// Same blending and texture coordinates as in Render
+		if(m_penumbraBrightness != 1.0f)
+		{
+			mode = ShadowBatch::blend_multiply;
+			alpha = m_penumbraBrightness * transparency;
+
+			texCoords[0] = Vec2f(0.0f, 1.0f);
+			texCoords[1] = Vec2f(1.0f, 0.0f);
+			texCoords[2] = Vec2f(0.0f, 0.0f);
+		}
+		else
+		{
+			mode = ShadowBatch::blend_multiplyInverse;
+
+			if(m_umbraBrightness != 1.0f)
+				alpha = (1.0f - m_umbraBrightness) * transparency;
+			else
+				alpha = transparency;
+
+			texCoords[0] = Vec2f(0.0f, 1.0f);
+			texCoords[1] = Vec2f(0.0f, 0.0f);
+			texCoords[2] = Vec2f(1.0f, 0.0f);
+		}
+
+		if(pClipRegion != NULL)
+			pClipRegion->ClipPolygon(positions, texCoords);
+
+		batch.AddPolygon(mode, positions, texCoords, 0.0f, alpha);
+	}
 }
@@ -0,0 +1,211 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <LTBL/Light/ShadowUnion.h>
+#include <LTBL/Utils.h>
+
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace ltbl
+{
+	void ShadowUnion::Polygon::CalculateAABB()
+	{
+		m_aabb.m_lowerBound = m_vertices[0];
+		m_aabb.m_upperBound = m_vertices[0];
+
+		for(unsigned int i = 1, numVertices = m_vertices.size(); i < numVertices; i++)
+		{
+			m_aabb.m_lowerBound.x = std::min(m_aabb.m_lowerBound.x, m_vertices[i].x);
+			m_aabb.m_lowerBound.y = std::min(m_aabb.m_lowerBound.y, m_vertices[i].y);
+			m_aabb.m_upperBound.x = std::max(m_aabb.m_upperBound.x, m_vertices[i].x);
+			m_aabb.m_upperBound.y = std::max(m_aabb.m_upperBound.y, m_vertices[i].y);
+		}
+
+		m_aabb.CalculateHalfDims();
+		m_aabb.CalculateCenter();
+	}
+
+	void ShadowUnion::Clear()
+	{
+		m_pieces.clear();
+	}
+
+	bool ShadowUnion::Empty() const
+	{
+		return m_pieces.empty();
+	}
+
+	float ShadowUnion::SignedArea(const std::vector<Vec2f> &vertices)
+	{
+		float area = 0.0f;
+
+		for(unsigned int i = 0, numVertices = vertices.size(); i < numVertices; i++)
+			area += vertices[i].Cross(vertices[Wrap(i + 1, numVertices)]);
+
+		return area / 2.0f;
+	}
+
+	void ShadowUnion::AddConvexPolygon(const std::vector<Vec2f> &vertices)
+	{
+		float area = SignedArea(vertices);
+
+		// Skip slivers
+		if(std::abs(area) < 0.001f)
+			return;
+
+		m_remaining.resize(1);
+
+		Polygon &polygon = m_remaining[0];
+		polygon.m_vertices = vertices;
+
+		// Subtraction expects counter-clockwise polygons
+		if(area < 0.0f)
+			std::reverse(polygon.m_vertices.begin(), polygon.m_vertices.end());
+
+		polygon.CalculateAABB();
+
+		for(unsigned int p = 0, numPieces = m_pieces.size(); p < numPieces && !m_remaining.empty(); p++)
+		{
+			m_nextRemaining.clear();
+
+			for(unsigned int r = 0, numRemaining = m_remaining.size(); r < numRemaining; r++)
+			{
+				if(m_remaining[r].m_aabb.Intersects(m_pieces[p].m_aabb))
+					Subtract(m_remaining[r], m_pieces[p], m_nextRemaining);
+				else
+					m_nextRemaining.push_back(m_remaining[r]);
+			}
+
+			m_remaining.swap(m_nextRemaining);
+		}
+
+		m_pieces.insert(m_pieces.end(), m_remaining.begin(), m_remaining.end());
+	}
+
+	void ShadowUnion::Subtract(const Polygon &polygon, const Polygon &other, std::vector<Polygon> &result)
+	{
+		m_positions = polygon.m_vertices;
+
+		const unsigned int numEdges = other.m_vertices.size();
+
+		// Peel off the part outside of each edge, continue with the part inside
+		for(unsigned int i = 0; i < numEdges && !m_positions.empty(); i++)
+		{
+			const Vec2f &start = other.m_vertices[i];
+			const Vec2f &end = other.m_vertices[Wrap(i + 1, numEdges)];
+
+			ClipRegion::ClipToLine(end, start, m_positions, m_noTexCoords, m_tempPositions, m_tempTexCoords);
+
+			if(m_tempPositions.size() >= 3 && std::abs(SignedArea(m_tempPositions)) >= 0.001f)
+			{
+				result.push_back(Polygon());
+				result.back().m_vertices = m_tempPositions;
+				result.back().CalculateAABB();
+			}
+
+			ClipRegion::ClipToLine(start, end, m_positions, m_noTexCoords, m_tempPositions, m_tempTexCoords);
+
+			m_positions.swap(m_tempPositions);
+
+			if(m_positions.size() < 3)
+				m_positions.clear();
+		}
+
+		// What is left is inside of the other polygon, and therefore already covered
+	}
+
+	void ShadowUnion::AddStrip(const std::vector<Vec2f> &strip, const ClipRegion* pClipRegion)
+	{
+		std::vector<Vec2f> quad;
+		std::vector<Vec2f> noTexCoords;
+
+		// The strip consists of pairs of ray points, so it can be split into quads
+		for(unsigned int i = 3, numStripVertices = strip.size(); i < numStripVertices; i += 2)
+		{
+			quad.resize(4);
+
+			quad[0] = strip[i - 3];
+			quad[1] = strip[i - 2];
+			quad[2] = strip[i];
+			quad[3] = strip[i - 1];
+
+			float cross0 = (quad[1] - quad[0]).Cross(quad[2] - quad[1]);
+			float cross1 = (quad[2] - quad[1]).Cross(quad[3] - quad[2]);
+			float cross2 = (quad[3] - quad[2]).Cross(quad[0] - quad[3]);
+			float cross3 = (quad[0] - quad[3]).Cross(quad[1] - quad[0]);
+
+			bool convex = (cross0 >= 0.0f && cross1 >= 0.0f && cross2 >= 0.0f && cross3 >= 0.0f) ||
+				(cross0 <= 0.0f && cross1 <= 0.0f && cross2 <= 0.0f && cross3 <= 0.0f);
+
+			if(convex)
+			{
+				if(pClipRegion != NULL)
+					pClipRegion->ClipPolygon(quad, noTexCoords);
+
+				if(!quad.empty())
+					AddConvexPolygon(quad);
+			}
+			else
+			{
+				// Fall back to the two triangles of the strip
+				for(unsigned int t = 0; t < 2; t++)
+				{
+					quad.resize(3);
+
+					quad[0] = strip[i - 3 + t];
+					quad[1] = strip[i - 2 + t];
+					quad[2] = strip[i - 1 + t];
+
+					if(pClipRegion != NULL)
+						pClipRegion->ClipPolygon(quad, noTexCoords);
+
+					if(!quad.empty())
+						AddConvexPolygon(quad);
+				}
+			}
+		}
+	}
+
+	void ShadowUnion::Render(float depth)
+	{
+		for(unsigned int p = 0, numPieces = m_pieces.size(); p < numPieces; p++)
+		{
+			const std::vector<Vec2f> &vertices = m_pieces[p].m_vertices;
+
+			glBegin(GL_TRIANGLE_FAN);
+
+			for(unsigned int v = 0, numVertices = vertices.size(); v < numVertices; v++)
+				glVertex3f(vertices[v].x, vertices[v].y, depth);
+
+			glEnd();
+		}
+	}
+
+	void ShadowUnion::AddToBatch(ShadowBatch &batch, const Vec2f &texCoord, float depth)
+	{
+		for(unsigned int p = 0, numPieces = m_pieces.size(); p < numPieces; p++)
+			batch.AddPolygon(ShadowBatch::blend_umbra, m_pieces[p].m_vertices, texCoord, depth, 0.0f);
+	}
+}
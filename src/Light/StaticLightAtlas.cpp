@@ -0,0 +1,499 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
+#include <LTBL/Light/StaticLightAtlas.h>
+
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <string>
+
+namespace ltbl
+{
+	namespace
+	{
+		const unsigned int defaultPageSize = 2048;
+
+		// Empty texels between regions, so filtering does not pick up the neighbours
+		const unsigned int regionPadding = 1;
+
+		// Shelf heights are rounded up to this, so lights of similar size share shelves
+		const unsigned int shelfGranularity = 16;
+	}
+
+	StaticLightAtlas::Region::Region()
+		: m_page(-1), m_x(0), m_y(0), m_width(0), m_height(0), m_scale(1.0f)
+	{
+	}
+
+	StaticLightAtlas::StaticLightAtlas()
+		: m_pageSize(defaultPageSize), m_format(format_rgba8), m_compositeShaderAvailable(false)
+	{
+	}
+
+	StaticLightAtlas::~StaticLightAtlas()
+	{
+		Clear();
+	}
+
+	void StaticLightAtlas::Create(bool useVertexBuffer)
+	{
+		m_stream.Create(useVertexBuffer);
+
+		m_pageSize = std::min(defaultPageSize, sf::Texture::getMaximumSize());
+
+		if(!sf::Shader::isAvailable())
+			return;
+
+		// The mask is white, so the red channel holds the light for all formats
+		const std::string compositeShaderSource =
+			"uniform sampler2D page;\n"
+			"void main()\n"
+			"{\n"
+			"	gl_FragColor = vec4(gl_Color.rgb * texture2D(page, gl_TexCoord[0].xy).r, 1.0);\n"
+			"}\n";
+
+		m_compositeShaderAvailable = m_compositeShader.loadFromMemory(compositeShaderSource, sf::Shader::Fragment);
+
+		if(m_compositeShaderAvailable)
+			m_compositeShader.setParameter("page", sf::Shader::CurrentTexture);
+	}
+
+	bool StaticLightAtlas::SetFormat(TextureFormat format)
+	{
+		// Single channel pages can only be tinted with the shader
+		if(!m_compositeShaderAvailable)
+			format = format_rgba8;
+
+		if(format == m_format)
+			return false;
+
+		m_format = format;
+
+		Clear();
+
+		return true;
+	}
+
+	StaticLightAtlas::Page* StaticLightAtlas::CreatePage(unsigned int width, unsigned int height)
+	{
+		Page* pPage = new Page();
+
+		if(!pPage->m_texture.create(width, height, false))
+		{
+			delete pPage;
+
+			return NULL;
+		}
+
+		pPage->m_texture.setSmooth(true);
+
+		// Activates the page
+		pPage->m_texelSize = SetRenderTextureFormat(pPage->m_texture, m_format) ? GetTextureFormatSize(m_format) : 4;
+
+		glEnable(GL_BLEND);
+		glEnable(GL_TEXTURE_2D);
+
+		pPage->m_nextShelfY = 0;
+		pPage->m_numRegions = 0;
+
+		return pPage;
+	}
+
+	bool StaticLightAtlas::AllocateInPage(Page* pPage, unsigned int width, unsigned int height, Region &region)
+	{
+		const sf::Vector2u pageSize(pPage->m_texture.getSize());
+
+		const unsigned int paddedWidth = width + regionPadding;
+		const unsigned int shelfHeight = ((height + regionPadding + shelfGranularity - 1) / shelfGranularity) * shelfGranularity;
+
+		// Best fitting existing shelf
+		Shelf* pBestShelf = NULL;
+		unsigned int bestSpan = 0;
+
+		for(unsigned int s = 0, numShelves = pPage->m_shelves.size(); s < numShelves; s++)
+		{
+			Shelf &shelf = pPage->m_shelves[s];
+
+			// Do not waste tall shelves on small lights
+			if(shelf.m_height < height + regionPadding || shelf.m_height > shelfHeight * 2)
+				continue;
+
+			if(pBestShelf != NULL && shelf.m_height >= pBestShelf->m_height)
+				continue;
+
+			for(unsigned int i = 0, numSpans = shelf.m_freeSpans.size(); i < numSpans; i++)
+				if(shelf.m_freeSpans[i].m_width >= paddedWidth)
+				{
+					pBestShelf = &shelf;
+					bestSpan = i;
+
+					break;
+				}
+		}
+
+		// Open a new shelf
+		if(pBestShelf == NULL)
+		{
+			if(pPage->m_nextShelfY + shelfHeight > pageSize.y || paddedWidth > pageSize.x)
+			{
+				// A region spanning the whole page does not need the padding
+				if(pPage->m_shelves.empty() && width <= pageSize.x && height <= pageSize.y)
+				{
+					Shelf shelf;
+					shelf.m_y = 0;
+					shelf.m_height = pageSize.y;
+
+					pPage->m_shelves.push_back(shelf);
+					pPage->m_nextShelfY = pageSize.y;
+
+					region.m_x = 0;
+					region.m_y = 0;
+					region.m_width = width;
+					region.m_height = height;
+
+					pPage->m_numRegions++;
+
+					return true;
+				}
+
+				return false;
+			}
+
+			Shelf shelf;
+			shelf.m_y = pPage->m_nextShelfY;
+			shelf.m_height = shelfHeight;
+
+			Span span;
+			span.m_x = 0;
+			span.m_width = pageSize.x;
+
+			shelf.m_freeSpans.push_back(span);
+
+			pPage->m_shelves.push_back(shelf);
+			pPage->m_nextShelfY += shelfHeight;
+
+			pBestShelf = &pPage->m_shelves.back();
+			bestSpan = 0;
+		}
+
+		Span &span = pBestShelf->m_freeSpans[bestSpan];
+
+		region.m_x = span.m_x;
+		region.m_y = pBestShelf->m_y;
+		region.m_width = width;
+		region.m_height = height;
+
+		span.m_x += paddedWidth;
+		span.m_width -= paddedWidth;
+
+		if(span.m_width == 0)
+			pBestShelf->m_freeSpans.erase(pBestShelf->m_freeSpans.begin() + bestSpan);
+
+		pPage->m_numRegions++;
+
+		return true;
+	}
+
+	bool StaticLightAtlas::Allocate(unsigned int width, unsigned int height, Region &region, bool allowNewPage)
+	{
+		assert(region.m_page == -1);
+
+		for(unsigned int p = 0, numPages = m_pages.size(); p < numPages; p++)
+			if(m_pages[p] != NULL && AllocateInPage(m_pages[p], width, height, region))
+			{
+				region.m_page = p;
+
+				return true;
+			}
+
+		if(!allowNewPage)
+			return false;
+
+		// Lights larger than a page get a page of their own
+		Page* pPage = CreatePage(std::max(width, m_pageSize), std::max(height, m_pageSize));
+
+		if(pPage == NULL)
+			return false;
+
+		// Reuse slots of released pages
+		unsigned int pageIndex = 0;
+
+		while(pageIndex < m_pages.size() && m_pages[pageIndex] != NULL)
+			pageIndex++;
+
+		if(pageIndex == m_pages.size())
+			m_pages.push_back(pPage);
+		else
+			m_pages[pageIndex] = pPage;
+
+		AllocateInPage(pPage, width, height, region);
+
+		region.m_page = pageIndex;
+
+		return true;
+	}
+
+	void StaticLightAtlas::Free(Region &region)
+	{
+		if(region.m_page == -1)
+			return;
+
+		Page* pPage = m_pages[region.m_page];
+
+		assert(pPage != NULL && pPage->m_numRegions > 0);
+
+		pPage->m_numRegions--;
+
+		// Release empty pages, except for the first one
+		if(pPage->m_numRegions == 0 && region.m_page != 0)
+		{
+			delete pPage;
+
+			m_pages[region.m_page] = NULL;
+		}
+		else if(pPage->m_numRegions == 0)
+		{
+			pPage->m_shelves.clear();
+			pPage->m_nextShelfY = 0;
+		}
+		else
+		{
+			for(unsigned int s = 0, numShelves = pPage->m_shelves.size(); s < numShelves; s++)
+			{
+				Shelf &shelf = pPage->m_shelves[s];
+
+				if(shelf.m_y != region.m_y)
+					continue;
+
+				Span span;
+				span.m_x = region.m_x;
+				span.m_width = std::min(region.m_width + regionPadding, pPage->m_texture.getSize().x - region.m_x);
+
+				// Insert sorted, merging with the neighbours
+				unsigned int i = 0;
+
+				while(i < shelf.m_freeSpans.size() && shelf.m_freeSpans[i].m_x < span.m_x)
+					i++;
+
+				shelf.m_freeSpans.insert(shelf.m_freeSpans.begin() + i, span);
+
+				if(i + 1 < shelf.m_freeSpans.size() && shelf.m_freeSpans[i].m_x + shelf.m_freeSpans[i].m_width == shelf.m_freeSpans[i + 1].m_x)
+				{
+					shelf.m_freeSpans[i].m_width += shelf.m_freeSpans[i + 1].m_width;
+					shelf.m_freeSpans.erase(shelf.m_freeSpans.begin() + i + 1);
+				}
+
+				if(i > 0 && shelf.m_freeSpans[i - 1].m_x + shelf.m_freeSpans[i - 1].m_width == shelf.m_freeSpans[i].m_x)
+				{
+					shelf.m_freeSpans[i - 1].m_width += shelf.m_freeSpans[i].m_width;
+					shelf.m_freeSpans.erase(shelf.m_freeSpans.begin() + i);
+				}
+
+				break;
+			}
+		}
+
+		region = Region();
+	}
+
+	void StaticLightAtlas::Clear()
+	{
+		for(unsigned int p = 0, numPages = m_pages.size(); p < numPages; p++)
+			delete m_pages[p];
+
+		m_pages.clear();
+	}
+
+	void StaticLightAtlas::BeginRegion(const Region &region)
+	{
+		assert(region.m_page != -1);
+
+		Page* pPage = m_pages[region.m_page];
+
+		pPage->m_texture.setActive();
+
+		glViewport(region.m_x, region.m_y, region.m_width, region.m_height);
+
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+
+		// Flip the projection, same as the textures of the other render targets
+		glOrtho(0, region.m_width / region.m_scale, region.m_height / region.m_scale, 0, -100.0f, 100.0f);
+		glMatrixMode(GL_MODELVIEW);
+		glLoadIdentity();
+
+		// Keep the clear quad from bleeding into the neighbours
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(region.m_x, region.m_y, region.m_width, region.m_height);
+
+		// Clear with quad, like the other light textures. MUST clear with full color, with alpha!
+		glDisable(GL_TEXTURE_2D);
+		glColor4f(0.0f, 0.0f, 0.0f, 0.0f);
+
+		glBlendFunc(GL_ONE, GL_ZERO);
+
+		const float width = region.m_width / region.m_scale;
+		const float height = region.m_height / region.m_scale;
+
+		glBegin(GL_QUADS);
+			glVertex2f(0.0f, 0.0f);
+			glVertex2f(width, 0.0f);
+			glVertex2f(width, height);
+			glVertex2f(0.0f, height);
+		glEnd();
+
+		glEnable(GL_TEXTURE_2D);
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	void StaticLightAtlas::EndRegion(const Region &region)
+	{
+		glDisable(GL_SCISSOR_TEST);
+
+		m_pages[region.m_page]->m_texture.display();
+	}
+
+	void StaticLightAtlas::AddToComposite(const Region &region, const Vec2f &lowerBound, const Color3f &color, float intensity, LightTarget target)
+	{
+		assert(region.m_page != -1);
+
+		Page* pPage = m_pages[region.m_page];
+
+		const sf::Vector2u pageSize(pPage->m_texture.getSize());
+
+		const float width = region.m_width / region.m_scale;
+		const float height = region.m_height / region.m_scale;
+
+		// The projection is flipped, so the top of the region in world units is the upper row of texels
+		const float lowerU = static_cast<float>(region.m_x) / pageSize.x;
+		const float upperU = static_cast<float>(region.m_x + region.m_width) / pageSize.x;
+		const float lowerV = static_cast<float>(region.m_y) / pageSize.y;
+		const float upperV = static_cast<float>(region.m_y + region.m_height) / pageSize.y;
+
+		Vertex vertex;
+
+		// Vertex colors are clamped anyway
+		const float tintIntensity = std::min(intensity, 1.0f);
+
+		vertex.m_r = color.r * tintIntensity;
+		vertex.m_g = color.g * tintIntensity;
+		vertex.m_b = color.b * tintIntensity;
+
+		vertex.m_x = lowerBound.x; vertex.m_y = lowerBound.y; vertex.m_u = lowerU; vertex.m_v = upperV;
+		pPage->m_compositeVertices[target].push_back(vertex);
+
+		vertex.m_x = lowerBound.x + width; vertex.m_y = lowerBound.y; vertex.m_u = upperU; vertex.m_v = upperV;
+		pPage->m_compositeVertices[target].push_back(vertex);
+
+		vertex.m_x = lowerBound.x + width; vertex.m_y = lowerBound.y + height; vertex.m_u = upperU; vertex.m_v = lowerV;
+		pPage->m_compositeVertices[target].push_back(vertex);
+
+		vertex.m_x = lowerBound.x; vertex.m_y = lowerBound.y + height; vertex.m_u = lowerU; vertex.m_v = lowerV;
+		pPage->m_compositeVertices[target].push_back(vertex);
+	}
+
+	void StaticLightAtlas::RenderComposite(LightTarget target)
+	{
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+
+		glClientActiveTexture(GL_TEXTURE0);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+		// Pages are addressed in GL texture coordinates, so bind them without the flip SFML applies to render textures
+		sf::Texture::bind(NULL);
+
+		if(m_compositeShaderAvailable)
+			sf::Shader::bind(&m_compositeShader);
+
+		for(unsigned int p = 0, numPages = m_pages.size(); p < numPages; p++)
+		{
+			if(m_pages[p] == NULL || m_pages[p]->m_compositeVertices[target].empty())
+				continue;
+
+			std::vector<Vertex> &vertices = m_pages[p]->m_compositeVertices[target];
+
+			const char* pVertices = m_stream.Upload(&vertices[0], vertices.size() * sizeof(Vertex));
+
+			glVertexPointer(2, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_x));
+			glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_u));
+			glColorPointer(3, GL_FLOAT, sizeof(Vertex), pVertices + offsetof(Vertex, m_r));
+
+			glBindTexture(GL_TEXTURE_2D, m_pages[p]->m_texture.getTexture().getNativeHandle());
+
+			glDrawArrays(GL_QUADS, 0, vertices.size());
+
+			vertices.clear();
+		}
+
+		if(m_compositeShaderAvailable)
+			sf::Shader::bind(NULL);
+
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glDisableClientState(GL_COLOR_ARRAY);
+
+		m_stream.Unbind();
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		// Color arrays leave the current color undefined
+		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	unsigned int StaticLightAtlas::GetNumPages() const
+	{
+		unsigned int numPages = 0;
+
+		for(unsigned int p = 0, num = m_pages.size(); p < num; p++)
+			if(m_pages[p] != NULL)
+				numPages++;
+
+		return numPages;
+	}
+
+	unsigned int StaticLightAtlas::GetMemoryUsage() const
+	{
+		unsigned int memory = 0;
+
+		for(unsigned int p = 0, numPages = m_pages.size(); p < numPages; p++)
+			if(m_pages[p] != NULL)
+			{
+				sf::Vector2u size(m_pages[p]->m_texture.getSize());
+
+				memory += size.x * size.y * m_pages[p]->m_texelSize;
+			}
+
+		return memory;
+	}
+
+	unsigned int StaticLightAtlas::GetNewPageMemory(unsigned int width, unsigned int height) const
+	{
+		return std::max(width, m_pageSize) * std::max(height, m_pageSize) * GetTextureFormatSize(m_format);
+	}
+}
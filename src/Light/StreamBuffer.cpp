@@ -0,0 +1,72 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
+#include <LTBL/Light/StreamBuffer.h>
+
+#include <cstddef>
+
+namespace ltbl
+{
+	StreamBuffer::StreamBuffer()
+		: m_buffer(0), m_size(0)
+	{
+	}
+
+	StreamBuffer::~StreamBuffer()
+	{
+		if(m_buffer != 0)
+			glDeleteBuffers(1, &m_buffer);
+	}
+
+	void StreamBuffer::Create(bool useVertexBuffer)
+	{
+		if(useVertexBuffer && m_buffer == 0)
+			glGenBuffers(1, &m_buffer);
+	}
+
+	const char* StreamBuffer::Upload(const void* pData, unsigned int size)
+	{
+		if(m_buffer == 0)
+			return static_cast<const char*>(pData);
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+		if(size > m_size)
+			m_size = size;
+
+		// Orphan the old storage, so the driver does not have to wait for the draws of the previous upload
+		glBufferData(GL_ARRAY_BUFFER, m_size, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, pData);
+
+		return NULL;
+	}
+
+	void StreamBuffer::Unbind()
+	{
+		if(m_buffer != 0)
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
@@ -0,0 +1,132 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
+#include <LTBL/Light/TextureFormat.h>
+
+#include <SFML/OpenGL.hpp>
+
+namespace ltbl
+{
+	namespace
+	{
+		void ReallocateTexture(const sf::Texture &texture, TextureFormat format)
+		{
+			GLenum internalFormat = GL_RGBA8;
+			GLenum pixelFormat = GL_RGBA;
+
+			switch(format)
+			{
+			case format_rgba8:
+				break;
+			case format_rgb10a2:
+				internalFormat = GL_RGB10_A2;
+				break;
+			case format_rgba16f:
+				internalFormat = GL_RGBA16F_ARB;
+				break;
+			case format_r8:
+				internalFormat = GL_R8;
+				pixelFormat = GL_RED;
+				break;
+			case format_r16f:
+				internalFormat = GL_R16F;
+				pixelFormat = GL_RED;
+				break;
+			}
+
+			GLint previousTexture;
+			glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+
+			sf::Vector2u size(texture.getSize());
+
+			glBindTexture(GL_TEXTURE_2D, texture.getNativeHandle());
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size.x, size.y, 0, pixelFormat, GL_UNSIGNED_BYTE, NULL);
+
+			glBindTexture(GL_TEXTURE_2D, previousTexture);
+		}
+	}
+
+	bool TextureFormatSupported(TextureFormat format)
+	{
+		// Formats other than RGBA8 are only used if their completeness can be checked
+		if(format != format_rgba8 && !GLEW_EXT_framebuffer_object)
+			return false;
+
+		switch(format)
+		{
+		case format_rgba8:
+		case format_rgb10a2:
+			return true;
+		case format_rgba16f:
+			return GLEW_VERSION_3_0 || GLEW_ARB_texture_float;
+		case format_r8:
+			return GLEW_VERSION_3_0 || GLEW_ARB_texture_rg;
+		case format_r16f:
+			return GLEW_VERSION_3_0 || (GLEW_ARB_texture_rg && GLEW_ARB_texture_float);
+		}
+
+		return false;
+	}
+
+	unsigned int GetTextureFormatSize(TextureFormat format)
+	{
+		switch(format)
+		{
+		case format_rgba8:
+		case format_rgb10a2:
+			return 4;
+		case format_rgba16f:
+			return 8;
+		case format_r8:
+			return 1;
+		case format_r16f:
+			return 2;
+		}
+
+		return 4;
+	}
+
+	bool SetRenderTextureFormat(sf::RenderTexture &renTex, TextureFormat format)
+	{
+		renTex.setActive();
+
+		if(!TextureFormatSupported(format))
+		{
+			ReallocateTexture(renTex.getTexture(), format_rgba8);
+
+			return format == format_rgba8;
+		}
+
+		ReallocateTexture(renTex.getTexture(), format);
+
+		if(format == format_rgba8 || glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) == GL_FRAMEBUFFER_COMPLETE_EXT)
+			return true;
+
+		// Not renderable on this driver
+		ReallocateTexture(renTex.getTexture(), format_rgba8);
+
+		return false;
+	}
+}
@@ -0,0 +1,331 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// GLEW has to be included before any other OpenGL header
+#include <GL/glew.h>
+
+#include <LTBL/Light/TiledLightGrid.h>
+#include <LTBL/Light/LightQuads.h>
+
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+namespace ltbl
+{
+	TiledLightGrid::TiledLightGrid()
+		: m_tileSize(32), m_numTilesX(0), m_numTilesY(0), m_maxLights(0), m_maxLightsPerTile(0), m_numLights(0), m_numIndices(0),
+		m_indexTextureWidth(1024), m_indexTextureHeight(0), m_lightTexture(0), m_tileTexture(0), m_indexTexture(0), m_available(false)
+	{
+	}
+
+	TiledLightGrid::~TiledLightGrid()
+	{
+		if(m_lightTexture != 0)
+			glDeleteTextures(1, &m_lightTexture);
+
+		if(m_tileTexture != 0)
+			glDeleteTextures(1, &m_tileTexture);
+
+		if(m_indexTexture != 0)
+			glDeleteTextures(1, &m_indexTexture);
+	}
+
+	void TiledLightGrid::CreateTexture(unsigned int &texture, int internalFormat, unsigned int width, unsigned int height)
+	{
+		if(texture == 0)
+			glGenTextures(1, &texture);
+
+		glBindTexture(GL_TEXTURE_2D, texture);
+
+		// Texels are looked up, never interpolated
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	void TiledLightGrid::Create(unsigned int tileSize, unsigned int maxLights, unsigned int maxLightsPerTile)
+	{
+		m_tileSize = tileSize;
+		m_maxLights = maxLights;
+		m_maxLightsPerTile = maxLightsPerTile;
+
+		m_available = false;
+
+		if(!sf::Shader::isAvailable() || !GLEW_ARB_texture_float || !GLEW_VERSION_1_3)
+			return;
+
+		m_lightData.reserve(m_maxLights * 8);
+
+		// Room for every light to touch a few dozen tiles
+		m_indexTextureHeight = (m_maxLights * 32 + m_indexTextureWidth - 1) / m_indexTextureWidth;
+
+		CreateTexture(m_lightTexture, GL_RGBA32F_ARB, m_maxLights, 2);
+		CreateTexture(m_indexTexture, GL_LUMINANCE32F_ARB, m_indexTextureWidth, m_indexTextureHeight);
+
+		std::ostringstream maxLightsPerTileString;
+		maxLightsPerTileString << m_maxLightsPerTile;
+
+		const std::string fragmentShaderSource =
+			"uniform sampler2D lights;\n"
+			"uniform sampler2D tiles;\n"
+			"uniform sampler2D indices;\n"
+			"uniform float numLights;\n"
+			"uniform vec2 numTiles;\n"
+			"uniform vec2 indicesSize;\n"
+			"uniform float tileSize;\n" +
+			LightQuads::GetAttenuationSource() +
+			"void main()\n"
+			"{\n"
+			"	vec2 tile = floor(gl_FragCoord.xy / tileSize);\n"
+			"	vec4 header = texture2D(tiles, (tile + 0.5) / numTiles);\n"
+			"	vec3 color = vec3(0.0, 0.0, 0.0);\n"
+			"	for(int i = 0; i < " + maxLightsPerTileString.str() + "; i++)\n"
+			"	{\n"
+			"		if(float(i) >= header.y)\n"
+			"			break;\n"
+			"		float index = header.x + float(i);\n"
+			"		float light = texture2D(indices, (vec2(mod(index, indicesSize.x), floor(index / indicesSize.x)) + 0.5) / indicesSize).r;\n"
+			"		vec4 first = texture2D(lights, vec2((light + 0.5) / numLights, 0.25));\n"
+			"		vec4 second = texture2D(lights, vec2((light + 0.5) / numLights, 0.75));\n"
+			"		float dist = length(first.xy - gl_FragCoord.xy);\n"
+			"		color += second.rgb * Attenuation(dist, first.z, first.w, second.w);\n"
+			"	}\n"
+			"	gl_FragColor = vec4(color, 1.0);\n"
+			"}\n";
+
+		if(!m_shader.loadFromMemory(fragmentShaderSource, sf::Shader::Fragment))
+			return;
+
+		m_available = true;
+	}
+
+	bool TiledLightGrid::Available() const
+	{
+		return m_available;
+	}
+
+	void TiledLightGrid::Begin(const Vec2f &targetSize)
+	{
+		const unsigned int numTilesX = static_cast<unsigned int>(std::ceil(targetSize.x / m_tileSize));
+		const unsigned int numTilesY = static_cast<unsigned int>(std::ceil(targetSize.y / m_tileSize));
+
+		if(m_available && (numTilesX != m_numTilesX || numTilesY != m_numTilesY))
+			CreateTexture(m_tileTexture, GL_RGBA32F_ARB, numTilesX, numTilesY);
+
+		m_numTilesX = numTilesX;
+		m_numTilesY = numTilesY;
+
+		m_tileLights.resize(m_numTilesX * m_numTilesY);
+
+		for(unsigned int i = 0, numTiles = m_tileLights.size(); i < numTiles; i++)
+			m_tileLights[i].clear();
+
+		m_lightData.clear();
+		m_numLights = 0;
+		m_numIndices = 0;
+	}
+
+	bool TiledLightGrid::Empty() const
+	{
+		return m_numLights == 0;
+	}
+
+	bool TiledLightGrid::AddLight(const Vec2f &center, float radius, const Color3f &color, float bleed, float linearizeFactor)
+	{
+		if(!m_available || m_numLights >= m_maxLights)
+			return false;
+
+		const float tileSize = static_cast<float>(m_tileSize);
+
+		int lowerX = std::max(static_cast<int>(std::floor((center.x - radius) / tileSize)), 0);
+		int lowerY = std::max(static_cast<int>(std::floor((center.y - radius) / tileSize)), 0);
+		int upperX = std::min(static_cast<int>(std::floor((center.x + radius) / tileSize)), static_cast<int>(m_numTilesX) - 1);
+		int upperY = std::min(static_cast<int>(std::floor((center.y + radius) / tileSize)), static_cast<int>(m_numTilesY) - 1);
+
+		// Only tiles that the disk overlaps
+		m_tileIndices.clear();
+
+		for(int y = lowerY; y <= upperY; y++)
+			for(int x = lowerX; x <= upperX; x++)
+			{
+				Vec2f nearest(std::min(std::max(center.x, x * tileSize), (x + 1) * tileSize), std::min(std::max(center.y, y * tileSize), (y + 1) * tileSize));
+
+				if((nearest - center).MagnitudeSquared() > radius * radius)
+					continue;
+
+				const unsigned int tileIndex = x + y * m_numTilesX;
+
+				if(m_tileLights[tileIndex].size() >= m_maxLightsPerTile)
+					return false;
+
+				m_tileIndices.push_back(tileIndex);
+			}
+
+		if(m_tileIndices.empty())
+			return true;
+
+		// The flattened lists of all tiles have to fit into the index texture
+		if(m_numIndices + m_tileIndices.size() > m_indexTextureWidth * m_indexTextureHeight)
+			return false;
+
+		m_numIndices += m_tileIndices.size();
+
+		const float lightIndex = static_cast<float>(m_numLights);
+
+		for(unsigned int i = 0, numTiles = m_tileIndices.size(); i < numTiles; i++)
+			m_tileLights[m_tileIndices[i]].push_back(lightIndex);
+
+		m_lightData.push_back(center.x);
+		m_lightData.push_back(center.y);
+		m_lightData.push_back(radius);
+		m_lightData.push_back(bleed);
+
+		m_lightData.push_back(color.r);
+		m_lightData.push_back(color.g);
+		m_lightData.push_back(color.b);
+		m_lightData.push_back(linearizeFactor);
+
+		m_numLights++;
+
+		return true;
+	}
+
+	void TiledLightGrid::Render()
+	{
+		if(m_numLights == 0)
+			return;
+
+		// Flatten the tile lists
+		m_indices.clear();
+		m_tileHeaders.assign(m_numTilesX * m_numTilesY * 4, 0.0f);
+
+		for(unsigned int i = 0, numTiles = m_tileLights.size(); i < numTiles; i++)
+		{
+			const std::vector<float> &tileLights = m_tileLights[i];
+
+			m_tileHeaders[i * 4 + 0] = static_cast<float>(m_indices.size());
+			m_tileHeaders[i * 4 + 1] = static_cast<float>(tileLights.size());
+
+			m_indices.insert(m_indices.end(), tileLights.begin(), tileLights.end());
+		}
+
+		// AddLight refuses lights whose tiles would not fit
+		assert(m_indices.size() == m_numIndices && m_numIndices <= m_indexTextureWidth * m_indexTextureHeight);
+
+		const unsigned int numIndexRows = (m_indices.size() + m_indexTextureWidth - 1) / m_indexTextureWidth;
+		m_indices.resize(numIndexRows * m_indexTextureWidth, 0.0f);
+
+		// Two rows, the second one starts at the second texel of each light
+		m_lightUpload.resize(m_numLights * 8);
+
+		for(unsigned int l = 0; l < m_numLights; l++)
+			for(unsigned int c = 0; c < 4; c++)
+			{
+				m_lightUpload[l * 4 + c] = m_lightData[l * 8 + c];
+				m_lightUpload[(m_numLights + l) * 4 + c] = m_lightData[l * 8 + 4 + c];
+			}
+
+		glBindTexture(GL_TEXTURE_2D, m_lightTexture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_numLights, 1, GL_RGBA, GL_FLOAT, &m_lightUpload[0]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 1, m_numLights, 1, GL_RGBA, GL_FLOAT, &m_lightUpload[m_numLights * 4]);
+
+		glBindTexture(GL_TEXTURE_2D, m_tileTexture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_numTilesX, m_numTilesY, GL_RGBA, GL_FLOAT, &m_tileHeaders[0]);
+
+		if(numIndexRows != 0)
+		{
+			glBindTexture(GL_TEXTURE_2D, m_indexTexture);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_indexTextureWidth, numIndexRows, GL_LUMINANCE, GL_FLOAT, &m_indices[0]);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		sf::Shader::bind(&m_shader);
+
+		m_shader.setParameter("numLights", static_cast<float>(m_maxLights));
+		m_shader.setParameter("numTiles", static_cast<float>(m_numTilesX), static_cast<float>(m_numTilesY));
+		m_shader.setParameter("indicesSize", static_cast<float>(m_indexTextureWidth), static_cast<float>(m_indexTextureHeight));
+		m_shader.setParameter("tileSize", static_cast<float>(m_tileSize));
+
+		// SFML only binds its own textures, so the data textures go to fixed units
+		GLhandleARB program = static_cast<GLhandleARB>(m_shader.getNativeHandle());
+
+		glUniform1iARB(glGetUniformLocationARB(program, "lights"), 1);
+		glUniform1iARB(glGetUniformLocationARB(program, "tiles"), 2);
+		glUniform1iARB(glGetUniformLocationARB(program, "indices"), 3);
+
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, m_lightTexture);
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, m_tileTexture);
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, m_indexTexture);
+		glActiveTexture(GL_TEXTURE0);
+
+		glDisable(GL_TEXTURE_2D);
+
+		const float tileSize = static_cast<float>(m_tileSize);
+
+		// Only the tiles with lights are drawn
+		glBegin(GL_QUADS);
+
+		for(unsigned int y = 0; y < m_numTilesY; y++)
+			for(unsigned int x = 0; x < m_numTilesX; x++)
+			{
+				if(m_tileHeaders[(x + y * m_numTilesX) * 4 + 1] == 0.0f)
+					continue;
+
+				glVertex2f(x * tileSize, y * tileSize);
+				glVertex2f((x + 1) * tileSize, y * tileSize);
+				glVertex2f((x + 1) * tileSize, (y + 1) * tileSize);
+				glVertex2f(x * tileSize, (y + 1) * tileSize);
+			}
+
+		glEnd();
+
+		sf::Shader::bind(NULL);
+
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glActiveTexture(GL_TEXTURE0);
+
+		glEnable(GL_TEXTURE_2D);
+
+		m_lightData.clear();
+		m_numLights = 0;
+		m_numIndices = 0;
+	}
+}
@@ -0,0 +1,292 @@
+/*
+	Let There Be Light
+	Copyright (C) 2012 Eric Laukien
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+		claim that you wrote the original software. If you use this software
+		in a product, an acknowledgment in the product documentation would be
+		appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+		misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <LTBL/Light/VisibilityPolygon.h>
+#include <LTBL/Utils.h>
+
+#include <SFML/OpenGL.hpp>
+
+#include <algorithm>
+
+namespace ltbl
+{
+	bool VisibilityPolygon::Event::operator<(const Event &other) const
+	{
+		if(m_angle != other.m_angle)
+			return m_angle < other.m_angle;
+
+		return !m_insert && other.m_insert;
+	}
+
+	VisibilityPolygon::CloserSegment::CloserSegment(const VisibilityPolygon* pPolygon)
+		: m_pPolygon(pPolygon)
+	{
+	}
+
+	bool VisibilityPolygon::CloserSegment::operator()(unsigned int first, unsigned int second) const
+	{
+		float firstDistance = m_pPolygon->GetDistance(first, m_pPolygon->m_sweepDirection);
+		float secondDistance = m_pPolygon->GetDistance(second, m_pPolygon->m_sweepDirection);
+
+		if(firstDistance != secondDistance)
+			return firstDistance < secondDistance;
+
+		return first < second;
+	}
+
+	VisibilityPolygon::VisibilityPolygon()
+		: m_radius(0.0f), m_sweepDirection(1.0f, 0.0f)
+	{
+	}
+
+	void VisibilityPolygon::Begin(const Vec2f &center, float radius)
+	{
+		m_center = center;
+		m_radius = radius;
+
+		m_segments.clear();
+		m_vertices.clear();
+	}
+
+	void VisibilityPolygon::AddHull(const ConvexHull &hull, bool lightOverHull)
+	{
+		const unsigned int numVertices = hull.m_vertices.size();
+
+		Vec2f hCenter(hull.GetWorldCenter());
+
+		for(unsigned int i = 0; i < numVertices; i++)
+		{
+			Segment segment;
+			segment.m_start = hull.GetWorldVertex(i);
+			segment.m_end = hull.GetWorldVertex(Wrap(i + 1, numVertices));
+
+			Vec2f edge(segment.m_end - segment.m_start);
+
+			// Edges facing away from the light have the light on the same side as the hull center
+			bool backFacing = (edge.Cross(hCenter - segment.m_start) >= 0.0f) == (edge.Cross(m_center - segment.m_start) >= 0.0f);
+
+			if(lightOverHull && !backFacing)
+				continue;
+
+			Vec2f toStart(segment.m_start - m_center);
+			Vec2f toEnd(segment.m_end - m_center);
+
+			float cross = toStart.Cross(toEnd);
+
+			// Edges pointing at the center cover no angle
+			if(std::abs(cross) < 0.000001f)
+				continue;
+
+			// Closest point of the edge, edges outside of the radius can not block the light
+			float edgeLengthSquared = edge.MagnitudeSquared();
+			float along = std::min(std::max(-toStart.Dot(edge) / edgeLengthSquared, 0.0f), 1.0f);
+
+			if((toStart + edge * along).MagnitudeSquared() >= m_radius * m_radius)
+				continue;
+
+			if(cross < 0.0f)
+			{
+				std::swap(segment.m_start, segment.m_end);
+				std::swap(toStart, toEnd);
+				cross = -cross;
+			}
+
+			// From the vertices, so edges sharing a vertex start and end at exactly the same angle
+			segment.m_startAngle = std::atan2(toStart.y, toStart.x);
+			segment.m_endAngle = std::atan2(toEnd.y, toEnd.x);
+
+			m_segments.push_back(segment);
+		}
+	}
+
+	float VisibilityPolygon::GetDistance(unsigned int segment, const Vec2f &direction) const
+	{
+		const Segment &s = m_segments[segment];
+
+		Vec2f edge(s.m_end - s.m_start);
+
+		float denom = direction.Cross(edge);
+
+		// Parallel, only at angles the segment does not cover
+		if(std::abs(denom) < 0.000001f)
+			return m_radius;
+
+		return (s.m_start - m_center).Cross(edge) / denom;
+	}
+
+	void VisibilityPolygon::AddBoundaryVertex(const ActiveSegments &activeSegments, float angle)
+	{
+		Vec2f direction(std::cos(angle), std::sin(angle));
+
+		float distance = m_radius;
+
+		if(!activeSegments.empty())
+			distance = std::min(GetDistance(*activeSegments.begin(), direction), m_radius);
+
+		m_vertices.push_back(m_center + direction * distance);
+	}
+
+	void VisibilityPolygon::Compute(float lowerAngle, float upperAngle, float subdivisionSize)
+	{
+		const float range = std::min(upperAngle - lowerAngle, pifTimes2);
+
+		// Each segment is active from its start to its end angle, relative to the lower angle
+		m_events.clear();
+
+		for(unsigned int i = 0, numSegments = m_segments.size(); i < numSegments; i++)
+		{
+			const Segment &segment = m_segments[i];
+
+			float start = segment.m_startAngle - lowerAngle;
+			start -= std::floor(start / pifTimes2) * pifTimes2;
+
+			float end = segment.m_endAngle - lowerAngle;
+			end -= std::floor(end / pifTimes2) * pifTimes2;
+
+			if(end < start)
+				end += pifTimes2;
+
+			// Rounding can flip edges that are nearly in line with the center, they would cover almost the full circle
+			if(end == start || end - start > pifTimes2 * 0.75f)
+				continue;
+
+			Event event;
+			event.m_segment = i;
+
+			if(start <= range)
+			{
+				event.m_angle = start;
+				event.m_insert = true;
+				m_events.push_back(event);
+
+				if(end <= range)
+				{
+					event.m_angle = end;
+					event.m_insert = false;
+					m_events.push_back(event);
+				}
+			}
+
+			// Wraps around past the lower angle, so it is active when the sweep starts
+			if(end > pifTimes2)
+			{
+				event.m_angle = 0.0f;
+				event.m_insert = true;
+				m_events.push_back(event);
+
+				if(end - pifTimes2 <= range)
+				{
+					event.m_angle = end - pifTimes2;
+					event.m_insert = false;
+					m_events.push_back(event);
+				}
+			}
+		}
+
+		std::sort(m_events.begin(), m_events.end());
+
+		ActiveSegments activeSegments((CloserSegment(this)));
+
+		m_activePositions.resize(m_segments.size());
+
+		// Boundary of the light
+		const int numSubdivisions = std::max(static_cast<int>(std::ceil(range / subdivisionSize)), 1);
+		const float angleStep = range / numSubdivisions;
+
+		m_vertices.clear();
+
+		m_vertices.push_back(m_center);
+
+		unsigned int nextEvent = 0;
+		const unsigned int numEvents = m_events.size();
+
+		for(int nextSubdivision = 0; nextSubdivision <= numSubdivisions;)
+		{
+			const float subdivisionAngle = nextSubdivision == numSubdivisions ? range : nextSubdivision * angleStep;
+
+			if(nextEvent == numEvents || m_events[nextEvent].m_angle > subdivisionAngle)
+			{
+				AddBoundaryVertex(activeSegments, lowerAngle + subdivisionAngle);
+
+				nextSubdivision++;
+
+				continue;
+			}
+
+			const float angle = m_events[nextEvent].m_angle;
+
+			unsigned int groupEnd = nextEvent;
+
+			while(groupEnd < numEvents && m_events[groupEnd].m_angle == angle)
+				groupEnd++;
+
+			while(nextSubdivision < numSubdivisions && nextSubdivision * angleStep <= angle)
+				nextSubdivision++;
+
+			// Boundary up to the events, the nearest segment may end here
+			if(angle > 0.0f)
+				AddBoundaryVertex(activeSegments, lowerAngle + angle);
+
+			// The active segments stay the same up to the next stop, so they are ordered halfway to it
+			float nextAngle = nextSubdivision == numSubdivisions ? range : nextSubdivision * angleStep;
+
+			if(groupEnd < numEvents)
+				nextAngle = std::min(nextAngle, m_events[groupEnd].m_angle);
+
+			const float orderAngle = lowerAngle + (angle + nextAngle) * 0.5f;
+
+			m_sweepDirection = Vec2f(std::cos(orderAngle), std::sin(orderAngle));
+
+			for(; nextEvent < groupEnd; nextEvent++)
+			{
+				const Event &event = m_events[nextEvent];
+
+				if(event.m_insert)
+					m_activePositions[event.m_segment] = activeSegments.insert(event.m_segment).first;
+				else
+					activeSegments.erase(m_activePositions[event.m_segment]);
+			}
+
+			// Boundary after the events, a nearer segment may start here
+			AddBoundaryVertex(activeSegments, lowerAngle + angle);
+
+			// The light boundary at the same angle would only repeat the vertex
+			if(nextSubdivision == numSubdivisions && angle == range)
+				break;
+		}
+	}
+
+	const std::vector<Vec2f> &VisibilityPolygon::GetVertices() const
+	{
+		return m_vertices;
+	}
+
+	void VisibilityPolygon::Render()
+	{
+		glBegin(GL_TRIANGLE_FAN);
+
+		for(unsigned int i = 0, numVertices = m_vertices.size(); i < numVertices; i++)
+			glVertex2f(m_vertices[i].x, m_vertices[i].y);
+
+		glEnd();
+	}
+}